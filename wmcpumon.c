@@ -54,12 +54,28 @@
 #include <string.h>
 #include <poll.h>
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <time.h>
+
+#include <dirent.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/shm.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
 
 #include <xcb/xcb.h>
 #include <xcb/shm.h>
@@ -84,6 +100,12 @@ xcb_gcontext_t NormalGC;		///< normal graphic context
 xcb_pixmap_t Pixmap;			///< our background pixmap
 
 xcb_pixmap_t Image;			///< drawing data
+xcb_pixmap_t AtlasPixmap;		///< pre-rendered bar and graph states
+int Scale = 1;				///< scale of the 64x64 layout
+
+xcb_gcontext_t TextGC;			///< text graphic context
+int TextAscent;				///< ascent of the text font
+int TextWidth;				///< character width of the text font
 
 #ifdef SCREENSAVER
 int ScreenSaverEventId;			///< screen saver event ids
@@ -96,8 +118,31 @@ static char Logscale;			///< show cpu bar in logarithmic scale
 static char AllCpus;			///< use aggregate numbers of all cpus
 static char JoinCpus;			///< aggregate numbers of two cpus
 static char UseSleep;			///< use sleep while screensaver runs
+static const char *CgroupDir;		///< cgroup v2 directory to monitor
+static char PagingRates;		///< show paging rates from vmstat
+static const char *DiskList;		///< disks to monitor
+static const char *NetList;		///< network interfaces to monitor
+static char IrqMode;			///< show cpus with most interrupts
+static char RunQueue;			///< show run queue latency
+static int ProcessPid;			///< process to monitor
+static char Summarize;			///< show load distribution of all cpus
+static char PerfMode;			///< show software perf event rates
+static int PerfBar;			///< perf event of the bars
+static const char *LayoutSpec;		///< layout description or file
+static const char *AlertHook;		///< program run on alarm changes
+static const char *Housekeeping;	///< cpus allowed to run on
+static char IdlePolicy;			///< run with SCHED_IDLE
+static int Niceness;			///< nice value, 0 unchanged
+static char LockMemory;			///< lock memory against page faults
+static int TimerSlack;			///< timer slack in us, 0 unchanged
+static char *ReplayDir;			///< recorded /proc samples to replay
+static int BenchmarkTicks;		///< headless refreshes to measure
 
 extern void Timeout(void);		///< called from event loop
+extern void TopToggle(void);		///< called from event loop
+extern int LayoutCompile(void);		///< called from top toggle
+extern int PsiPollFds(struct pollfd *);	///< called from event loop
+extern void MemRefresh(void);		///< called from event loop
 
     /// logarithmic log10 table
 static const unsigned char Log10[] = {
@@ -113,11 +158,38 @@ static const unsigned char Log10[] = {
 //	XPM Stuff
 ////////////////////////////////////////////////////////////////////////////
 
+/**
+**	Scale 16 bit color component to TrueColor visual mask.
+**
+**	@param mask	color mask of the visual
+**	@param value	16 bit color component
+**
+**	@returns pixel bits of the color component.
+*/
+static inline uint32_t XpmTrueColor(uint32_t mask, uint32_t value)
+{
+    int bits;
+
+    if (!mask) {
+	return 0;
+    }
+    bits = __builtin_popcount(mask);
+    if (bits > 16) {
+	bits = 16;
+    }
+    return ((value >> (16 - bits)) << __builtin_ctz(mask)) & mask;
+}
+
 /**
 **	Convert XPM graphic to xcb_image.
 **
+**	On TrueColor visuals the pixels are computed from the visual masks,
+**	without round trips to the X11 server.  Native 32 bits per pixel
+**	images are filled row by row.
+**
 **	@param connection	XCB connection to X11 server
 **	@param colormap		window colormap
+**	@param visual		visual of the colormap, NULL if unknown
 **	@param depth		image depth
 **	@param transparent	pixel for transparent color
 **	@param data		XPM graphic data
@@ -128,8 +200,8 @@ static const unsigned char Log10[] = {
 **	@warning supports only a subset of XPM formats.
 */
 xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
-    xcb_colormap_t colormap, uint8_t depth, uint32_t transparent,
-    const char *const *data, uint8_t ** mask)
+    xcb_colormap_t colormap, const xcb_visualtype_t * visual, uint8_t depth,
+    uint32_t transparent, const char *const *data, uint8_t ** mask)
 {
     // convert table: ascii hex nibble to binary
     static const uint8_t hex[128] =
@@ -157,6 +229,8 @@ xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
     const char *line;
     int x;
     int y;
+    int true_color;
+    const char *const *table;
 
     if (sscanf(*data, "%d %d %d %d %c", &w, &h, &colors, &bytes_per_color,
 	    &dummy) != 4) {
@@ -172,10 +246,13 @@ xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
 	abort();
     }
     data++;
+    true_color = depth != 1 && visual
+	&& visual->_class == XCB_VISUAL_CLASS_TRUE_COLOR;
 
     //
     //	Read color table, send alloc color requests
     //
+    table = data;
     for (i = 0; i < colors; i++) {
 	int id;
 
@@ -183,6 +260,7 @@ xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
 	id = *line++;
 	color_to_pixel[id] = i;		// maps xpm color char to pixel
 	cookies[i].sequence = 0;
+	pixels[i] = 0UL;
 	while (*line) {			// multiple choices for color
 	    int r;
 	    int g;
@@ -225,8 +303,14 @@ xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
 	    b = (65535 * (b & 0xFF) / 255);
 	    g = (65535 * (g & 0xFF) / 255);
 
-	    // FIXME: should i use _unchecked here?
-	    if ((depth != 1 && type == 'c') || (depth == 1 && type == 'm')) {
+	    if (true_color && type == 'c') {
+		// high bits of each component, like the server does
+		pixels[i] = XpmTrueColor(visual->red_mask, r)
+		    | XpmTrueColor(visual->green_mask, g)
+		    | XpmTrueColor(visual->blue_mask, b);
+	    } else if ((depth != 1 && type == 'c') || (depth == 1
+		    && type == 'm')) {
+		// FIXME: should i use _unchecked here?
 		if (cookies[i].sequence) {
 		    fprintf(stderr, "XPM multiple color spec: \"%s\"\n", line);
 		    abort();
@@ -252,7 +336,7 @@ xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
 	    }
 	    pixels[i] = reply->pixel;
 	    free(reply);
-	} else {
+	} else if (!true_color) {
 	    // transparent or error
 	    pixels[i] = 0UL;
 	}
@@ -267,6 +351,12 @@ xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
 	xcb_image_create_native(connection, w, h,
 	(depth == 1) ? XCB_IMAGE_FORMAT_XY_BITMAP : XCB_IMAGE_FORMAT_Z_PIXMAP,
 	depth, NULL, 0L, NULL);
+    if (!image && depth != 1) {		// no server (-b), no pixmap formats
+	image =
+	    xcb_image_create(w, h, XCB_IMAGE_FORMAT_Z_PIXMAP, 32, depth, 32,
+	    32, XCB_IMAGE_ORDER_LSB_FIRST, XCB_IMAGE_ORDER_LSB_FIRST, NULL, 0L,
+	    NULL);
+    }
     if (!image) {			// failure
 	return image;
     }
@@ -277,12 +367,46 @@ xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
     if (mask) {
 	i = mask_width * h;
 	*mask = malloc(i);
-	if (!mask) {			// malloc failure
+	if (!*mask) {			// malloc failure
 	    mask = NULL;
 	} else {
 	    memset(*mask, 255, i);
 	}
     }
+    //
+    //	Native 32 bit pixels: fill rows directly
+    //
+    if (image->format == XCB_IMAGE_FORMAT_Z_PIXMAP && image->bpp == 32
+	&& image->byte_order ==
+	(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ?
+	    XCB_IMAGE_ORDER_LSB_FIRST : XCB_IMAGE_ORDER_MSB_FIRST)) {
+	uint32_t lut[256];
+	uint32_t *row;
+
+	// maps xpm color char directly to pixel
+	for (i = 0; i < 256; i++) {
+	    lut[i] = transparent;
+	}
+	for (i = 0; i < colors; i++) {
+	    if (color_to_pixel[*table[i] & 0xFF] != -1) {
+		lut[*table[i] & 0xFF] = pixels[i];
+	    }
+	}
+	for (y = 0; y < h; y++) {
+	    line = *data++;
+	    row = (uint32_t *) (image->data + y * image->stride);
+	    for (x = 0; x < w; x++) {
+		int c;
+
+		c = *line++ & 0xFF;
+		row[x] = lut[c];
+		if (mask && color_to_pixel[c] == -1) {
+		    (*mask)[(y * mask_width) + (x >> 3)] &= (~(1 << (x & 7)));
+		}
+	    }
+	}
+	return image;
+    }
 
     for (y = 0; y < h; y++) {
 	line = *data++;
@@ -303,6 +427,132 @@ xcb_image_t *XcbXpm2Image(xcb_connection_t * connection,
 
 ////////////////////////////////////////////////////////////////////////////
 
+/**
+**	Scale image with nearest neighbour by an integer factor.
+**
+**	32 bits per pixel images are scaled row by row, with SSE2 if
+**	available, other formats pixel by pixel.
+**
+**	@param image	image to scale, destroyed
+**	@param scale	integer scale factor
+**
+**	@returns scaled image.
+*/
+xcb_image_t *XcbImageScale(xcb_image_t * image, int scale)
+{
+    xcb_image_t *scaled;
+    int x;
+    int y;
+    int i;
+
+    scaled =
+	xcb_image_create(image->width * scale, image->height * scale,
+	image->format, image->scanline_pad, image->depth, image->bpp,
+	image->unit, image->byte_order, image->bit_order, NULL, 0, NULL);
+    if (!scaled) {
+	return image;
+    }
+    for (y = 0; y < image->height; y++) {
+	uint8_t *dst;
+
+	dst = scaled->data + y * scale * scaled->stride;
+	if (image->format == XCB_IMAGE_FORMAT_Z_PIXMAP && image->bpp == 32) {
+	    const uint32_t *s;
+	    uint32_t *d;
+
+	    s = (const uint32_t *)(image->data + y * image->stride);
+	    d = (uint32_t *) dst;
+	    x = 0;
+#ifdef __SSE2__
+	    if (scale == 2) {		// unpack doubles 4 pixels
+		for (; x + 4 <= image->width; x += 4) {
+		    __m128i v;
+
+		    v = _mm_loadu_si128((const __m128i *)(s + x));
+		    _mm_storeu_si128((__m128i *) (d + x * 2),
+			_mm_unpacklo_epi32(v, v));
+		    _mm_storeu_si128((__m128i *) (d + x * 2 + 4),
+			_mm_unpackhi_epi32(v, v));
+		}
+	    } else {			// broadcast each pixel
+		for (; x < image->width; x++) {
+		    __m128i v;
+
+		    v = _mm_set1_epi32(s[x]);
+		    for (i = 0; i + 4 <= scale; i += 4) {
+			_mm_storeu_si128((__m128i *) (d + x * scale + i), v);
+		    }
+		    for (; i < scale; i++) {
+			d[x * scale + i] = s[x];
+		    }
+		}
+	    }
+#endif
+	    for (; x < image->width; x++) {
+		for (i = 0; i < scale; i++) {
+		    d[x * scale + i] = s[x];
+		}
+	    }
+	} else {
+	    for (x = 0; x < image->width; x++) {
+		uint32_t pixel;
+
+		pixel = xcb_image_get_pixel(image, x, y);
+		for (i = 0; i < scale; i++) {
+		    xcb_image_put_pixel(scaled, x * scale + i, y * scale,
+			pixel);
+		}
+	    }
+	}
+	// duplicate the scaled row
+	for (i = 1; i < scale; i++) {
+	    memcpy(dst + i * scaled->stride, dst, scaled->stride);
+	}
+    }
+    xcb_image_destroy(image);
+
+    return scaled;
+}
+
+/**
+**	Scale bitmap with nearest neighbour by an integer factor.
+**
+**	@param bitmap	bitmap, LSB first, rows padded to bytes, freed
+**	@param width	width of bitmap
+**	@param height	height of bitmap
+**	@param scale	integer scale factor
+**
+**	@returns scaled bitmap.
+*/
+static uint8_t *BitmapScale(uint8_t * bitmap, int width, int height,
+    int scale)
+{
+    uint8_t *scaled;
+    int stride;
+    int x;
+    int y;
+
+    stride = (width * scale + 7) / 8;
+    if (!(scaled = calloc(stride, height * scale))) {
+	return bitmap;
+    }
+    for (y = 0; y < height * scale; y++) {
+	const uint8_t *s;
+	uint8_t *d;
+
+	s = bitmap + (y / scale) * ((width + 7) / 8);
+	d = scaled + y * stride;
+	for (x = 0; x < width * scale; x++) {
+	    if (s[x / scale >> 3] & (1 << (x / scale & 7))) {
+		d[x >> 3] |= 1 << (x & 7);
+	    }
+	}
+    }
+    free(bitmap);
+
+    return scaled;
+}
+
 /**
 **	Create pixmap.
 **
@@ -316,14 +566,36 @@ xcb_pixmap_t CreatePixmap(const char *const *data, xcb_pixmap_t * mask)
     xcb_pixmap_t pixmap;
     uint8_t *bitmap;
     xcb_image_t *image;
+    xcb_depth_iterator_t depths;
+    xcb_visualtype_iterator_t visuals;
+    const xcb_visualtype_t *visual;
+
+    // find the visual of the default colormap
+    visual = NULL;
+    depths = xcb_screen_allowed_depths_iterator(Screen);
+    for (; !visual && depths.rem; xcb_depth_next(&depths)) {
+	visuals = xcb_depth_visuals_iterator(depths.data);
+	for (; visuals.rem; xcb_visualtype_next(&visuals)) {
+	    if (visuals.data->visual_id == Screen->root_visual) {
+		visual = visuals.data;
+		break;
+	    }
+	}
+    }
 
     image =
-	XcbXpm2Image(Connection, Screen->default_colormap, Screen->root_depth,
-	0UL, data, mask ? &bitmap : NULL);
+	XcbXpm2Image(Connection, Screen->default_colormap, visual,
+	Screen->root_depth, 0UL, data, mask ? &bitmap : NULL);
     if (!image) {
 	fprintf(stderr, "Can't create image\n");
 	abort();
     }
+    if (Scale > 1) {
+	if (mask) {
+	    bitmap = BitmapScale(bitmap, image->width, image->height, Scale);
+	}
+	image = XcbImageScale(image, Scale);
+    }
     if (mask) {
 	*mask =
 	    xcb_create_pixmap_from_bitmap_data(Connection, Window, bitmap,
@@ -341,6 +613,102 @@ xcb_pixmap_t CreatePixmap(const char *const *data, xcb_pixmap_t * mask)
     return pixmap;
 }
 
+/**
+**	Copy area in 64x64 layout coordinates.
+**
+**	@param src	source drawable
+**	@param dst	destination drawable
+**	@param sx	source x
+**	@param sy	source y
+**	@param dx	destination x
+**	@param dy	destination y
+**	@param w	width
+**	@param h	height
+*/
+static inline void CopyArea(xcb_drawable_t src, xcb_drawable_t dst, int sx,
+    int sy, int dx, int dy, int w, int h)
+{
+    xcb_copy_area(Connection, src, dst, NormalGC, sx * Scale, sy * Scale,
+	dx * Scale, dy * Scale, w * Scale, h * Scale);
+}
+
+/**
+**	Clear window area in 64x64 layout coordinates.
+**
+**	@param x	x of area
+**	@param y	y of area
+**	@param w	width
+**	@param h	height
+*/
+static inline void ClearArea(int x, int y, int w, int h)
+{
+    xcb_clear_area(Connection, 0, Window, x * Scale, y * Scale, w * Scale,
+	h * Scale);
+}
+
+////////////////////////////////////////////////////////////////////////////
+//	Text Stuff
+////////////////////////////////////////////////////////////////////////////
+
+/**
+**	Draw text into our background pixmap.
+**
+**	The text GC and font are created with the first call, the smallest
+**	core font "5x7" is used, if available.  Scaled layouts use a font of
+**	the scaled size.
+**
+**	@param x	left x coordinate of the text
+**	@param y	top y coordinate of the text
+**	@param text	text to draw, with background
+*/
+void DrawText(int x, int y, const char *text)
+{
+    static const char *const names[] = { "5x7", "10x20", "12x24", "6x10",
+	"fixed"
+    };
+    unsigned u;
+    uint32_t values[4];
+    xcb_font_t font;
+    xcb_query_font_reply_t *reply;
+
+    if (!TextGC) {
+	font = xcb_generate_id(Connection);
+	u = Scale > 3 ? 2 : Scale - 1;	// font of the scaled size
+	for (; u < sizeof(names) / sizeof(*names); ++u) {
+	    xcb_generic_error_t *error;
+
+	    error =
+		xcb_request_check(Connection, xcb_open_font_checked(Connection,
+		    font, strlen(names[u]), names[u]));
+	    if (!error) {
+		break;
+	    }
+	    free(error);
+	}
+	TextAscent = 7;
+	TextWidth = 5;
+	if ((reply =
+		xcb_query_font_reply(Connection, xcb_query_font(Connection,
+			font), NULL))) {
+	    TextAscent = reply->font_ascent;
+	    TextWidth = reply->max_bounds.character_width;
+	    free(reply);
+	}
+
+	TextGC = xcb_generate_id(Connection);
+	values[0] = Screen->white_pixel;
+	values[1] = Screen->black_pixel;
+	values[2] = 0;
+	values[3] = font;
+	xcb_create_gc(Connection, TextGC, Pixmap,
+	    XCB_GC_FOREGROUND | XCB_GC_BACKGROUND | XCB_GC_GRAPHICS_EXPOSURES |
+	    XCB_GC_FONT, values);
+	xcb_close_font(Connection, font);
+    }
+    xcb_image_text_8(Connection, strlen(text), Pixmap, TextGC, x * Scale,
+	y * Scale + TextAscent, text);
+}
+
 ////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -348,21 +716,37 @@ xcb_pixmap_t CreatePixmap(const char *const *data, xcb_pixmap_t * mask)
 */
 void Loop(void)
 {
-    struct pollfd fds[1];
+    struct pollfd fds[3];
     xcb_generic_event_t *event;
+    int nfds;
     int n;
+    int i;
+    int stall;
     int delay;
 
     fds[0].fd = xcb_get_file_descriptor(Connection);
     fds[0].events = POLLIN | POLLPRI;
+    // pressure stall triggers refresh the memory area
+    nfds = 1 + PsiPollFds(fds + 1);
 
     delay = Rate;
     for (;;) {
 	// wait for events or timeout
-	if ((n = poll(fds, 1, delay)) < 0) {
+	if ((n = poll(fds, nfds, delay)) < 0) {
 	    return;
 	}
 	if (n) {
+	    stall = 0;
+	    for (i = 1; i < nfds; ++i) {
+		if (fds[i].revents & POLLERR) {	// trigger destroyed
+		    fds[i].fd = -1;
+		} else if (fds[i].revents & POLLPRI) {
+		    stall = 1;
+		}
+	    }
+	    if (stall && delay != -1) {	// not while screensaver runs
+		MemRefresh();
+	    }
 	    if (fds[0].revents & (POLLIN | POLLPRI)) {
 		if ((event = xcb_poll_for_event(Connection))) {
 
@@ -379,6 +763,11 @@ void Loop(void)
 			    }
 			    break;
 #endif
+			case XCB_BUTTON_PRESS:
+			    TopToggle();
+			    ClearArea(6, 6, 49, 39);
+			    xcb_flush(Connection);
+			    break;
 			case XCB_DESTROY_NOTIFY:
 			    return;
 			case 0:
@@ -398,12 +787,11 @@ void Loop(void)
 				} else if (delay == -1) {
 				    // screensave off, resume updates
 				    delay = Rate;
-				    xcb_copy_area(Connection, Image, Pixmap,
-					NormalGC, 6, 6, 6, 6, 49, 39);
-				    xcb_copy_area(Connection, Image, Pixmap,
-					NormalGC, 65, 57, 34, 22, 21, 7);
-				    xcb_clear_area(Connection, 0, Window, 6, 6,
-					49, 39);
+				    CopyArea(Image, Pixmap, 6, 6, 6, 6, 49,
+					39);
+				    CopyArea(Image, Pixmap, 65, 57, 34, 22,
+					21, 7);
+				    ClearArea(6, 6, 49, 39);
 				    xcb_flush(Connection);
 				}
 				break;
@@ -479,8 +867,8 @@ int Init(int argc, char *const argv[])
     xcb_create_gc(connection, normal, screen->root, mask, values);
 
     pixmap = xcb_generate_id(connection);
-    xcb_create_pixmap(connection, screen->root_depth, pixmap, screen->root, 64,
-	64);
+    xcb_create_pixmap(connection, screen->root_depth, pixmap, screen->root,
+	64 * Scale, 64 * Scale);
 
     //	Create the window
     window = xcb_generate_id(connection);
@@ -488,14 +876,14 @@ int Init(int argc, char *const argv[])
     mask = XCB_CW_BACK_PIXMAP | XCB_CW_EVENT_MASK;
     values[0] = pixmap;
     //values[1] = XCB_EVENT_MASK_EXPOSURE;
-    values[1] = XCB_EVENT_MASK_NO_EVENT;
+    values[1] = XCB_EVENT_MASK_BUTTON_PRESS;
 
     xcb_create_window(connection,	// Connection
 	XCB_COPY_FROM_PARENT,		// depth (same as root)
 	window,				// window Id
 	screen->root,			// parent window
 	0, 0,				// x, y
-	64, 64,				// width, height
+	64 * Scale, 64 * Scale,		// width, height
 	0,				// border_width
 	XCB_WINDOW_CLASS_INPUT_OUTPUT,	// class
 	screen->root_visual,		// visual
@@ -505,8 +893,8 @@ int Init(int argc, char *const argv[])
     size_hints.flags = 0;		// FIXME: bad lib design
     // xcb_icccm_size_hints_set_position(&size_hints, 0, 0, 0);
     // xcb_icccm_size_hints_set_size(&size_hints, 0, 64, 64);
-    xcb_icccm_size_hints_set_min_size(&size_hints, 64, 64);
-    xcb_icccm_size_hints_set_max_size(&size_hints, 64, 64);
+    xcb_icccm_size_hints_set_min_size(&size_hints, 64 * Scale, 64 * Scale);
+    xcb_icccm_size_hints_set_max_size(&size_hints, 64 * Scale, 64 * Scale);
     xcb_icccm_set_wm_normal_hints(connection, window, &size_hints);
 
     xcb_icccm_set_wm_class(connection, window, sizeof("wmcpumon,wmcpumon") - 1,
@@ -586,6 +974,12 @@ void Exit(void)
     if (Image) {
 	xcb_free_pixmap(Connection, Image);
     }
+    if (AtlasPixmap) {
+	xcb_free_pixmap(Connection, AtlasPixmap);
+    }
+    if (TextGC) {
+	xcb_free_gc(Connection, TextGC);
+    }
 
     xcb_disconnect(Connection);
     Connection = NULL;
@@ -596,368 +990,3844 @@ void Exit(void)
 ////////////////////////////////////////////////////////////////////////////
 
 // ------------------------------------------------------------------------- //
-// /proc/stat
-
-    ///
-    /// collected data from /proc/stat
-    /// @see /usr/src/linux/Documentation/filesystems/proc.txt
-    ///
-struct cpu_info
-{
-    uint64_t Idle;			///< time cpu idle
-    uint64_t Used;			///< time cpu used
-    int Load;				///< cpu load
-    int AvgLoad;			///< avg cpu load
-    int OldLoadSize;			///< old cpu load bar size
-    int OldAvgLoadSize;			///< old avg cpu load bar size
-} CpuInfo[MAX_CPUS];			///< cached cpu informations
-int Cpus;				///< number of cpus
 
 /**
-**	Read stat.
+**	Read a kernel pseudo file through an open descriptor.
 **
-**	@returns -1 if failures.
+**	The read always starts at offset 0, /proc and /sys files regenerate
+**	their contents, so the descriptor can be kept open.
 **
-**	FIXME: keep fd open!
+**	@param fd	open file descriptor
+**	@param buf	buffer for the file contents
+**	@param size	size of the buffer, including the terminating '\0'
+**
+**	@returns number of bytes read, -1 if failures.
 */
-int GetStat(void)
+int ReadFd(int fd, char *buf, int size)
 {
-    int fd;
     int n;
-    char buf[1024];
-    int cpu;
-    uint64_t user;
-    uint64_t nice;
-    uint64_t system;
-    uint64_t idle;
-    uint64_t used;
-    uint64_t total;
-
-    n = -1;
-    if ((fd = open("/proc/stat", O_RDONLY)) >= 0) {
-	n = read(fd, buf, sizeof(buf));
-	if (n > 0) {
-	    const char *s;
-
-	    buf[n] = '\0';
-	    n = 0;
-	    if (AllCpus) {
-		n = sscanf(buf,
-		    "cpu   %" PRIu64 "%" PRIu64 " %" PRIu64 " %" PRIu64 "",
-		    &user, &nice, &system, &idle);
-
-		used = user + nice + system;
-		total = used + idle - CpuInfo[0].Used - CpuInfo[0].Idle;
-
-		CpuInfo[0].Load = 0;
-		if (total && used > CpuInfo[0].Used) {
-		    CpuInfo[0].Load = (100 * (used - CpuInfo[0].Used)) / total;
-		}
-		CpuInfo[0].Idle = idle;
-		CpuInfo[0].Used = used;
-		Cpus = 1;
-	    } else {
-
-		// skip the first total cpu line
-		for (s = buf;;) {
-		    if (!(s = strchr(s + 6, '\n'))) {
-			break;
-		    }
-		    ++s;		// skip newline
-
-		    // each line is "cpuN values\n"
-		    n = sscanf(s,
-			"cpu%u %" PRIu64 " %" PRIu64 " %" PRIu64 " %" PRIu64,
-			&cpu, &user, &nice, &system, &idle);
-		    // end of cpu area
-		    if (n != 5) {
-			Cpus = cpu + 1;
-			break;
-		    }
-		    cpu -= StartCpu;
-		    if (cpu < 0) {
-			continue;
-		    }
-
-		    used = user + nice + system;
-
-		    // join two cpu's into one bar
-		    if (JoinCpus) {
-			uint64_t idle2;
-
-			if (!(s = strchr(s + 6, '\n'))) {
-			    break;
-			}
-			++s;		// skip newline
-			n = sscanf(s,
-			    "cpu%u %" PRIu64 " %" PRIu64 " %" PRIu64 " %"
-			    PRIu64, &cpu, &user, &nice, &system, &idle2);
-			// end of cpu area
-			if (n != 5) {
-			    Cpus = cpu + 1;
-			    break;
-			}
-			used += user + nice + system;
-			idle += idle2;
-			cpu >>= 1;
-		    }
 
-		    total =
-			used + idle - CpuInfo[cpu].Used - CpuInfo[cpu].Idle;
-
-		    CpuInfo[cpu].Load = 0;
-		    if (total && used > CpuInfo[cpu].Used) {
-			CpuInfo[cpu].Load = (100 * (used - CpuInfo[cpu].Used))
-			    / total;
-		    }
-		    CpuInfo[cpu].Idle = idle;
-		    CpuInfo[cpu].Used = used;
-
-		    /*
-		       printf("cpu %d %" PRIu64 " %" PRIu64 " %" PRIu64 " %"
-		       PRIu64 " %d\n", cpu, user, nice, system, idle,
-		       CpuInfo[cpu].Load);
-		     */
-		    if (cpu == MAX_CPUS - 1) {	// no more cpus are supported
-			Cpus = MAX_CPUS;
-			break;
-		    }
-		}
-	    }
-	}
-	close(fd);
+    if ((n = pread(fd, buf, size - 1, 0)) >= 0) {
+	buf[n] = '\0';
     }
     return n;
 }
 
-// ------------------------------------------------------------------------- //
-// /proc/meminfo
-
-static uint32_t MemTotal;		///< cached memory info total memory
-static uint32_t MemFree;		///< cached memory info free memory
-static uint32_t Cached;			///< cached memory info cached memory
-static uint32_t SwapFree;		///< cached memory info free swap
-static uint32_t SwapTotal;		///< cached memory info total swap
-
 /**
-**	Read meminfo.
+**	Read a kernel pseudo file of unknown size, the buffer grows as needed.
 **
-**	@returns -1 if failures.
+**	@param fd		open file descriptor
+**	@param[in,out] buf	malloc'ed buffer, with 16 bytes zeroed slack
+**				after the contents (for vector parsers)
+**	@param[in,out] size	size of the buffer without the slack
 **
-**	FIXME: keep fd open!
+**	@returns number of bytes read, -1 if failures.
 */
-int GetMeminfo(void)
+int ReadFdGrow(int fd, char **buf, int *size)
 {
-    int fd;
     int n;
-    char buf[1024];
+    char *p;
 
-    n = -1;
-    if ((fd = open("/proc/meminfo", O_RDONLY)) >= 0) {
-	n = read(fd, buf, sizeof(buf));
-	if (n > 0) {
-	    const char *s;
-
-	    buf[n] = '\0';
-	    n = 0;
-	    for (s = buf; n < 5;) {
-		// each line is "name: value kb\n"
-		if (!strncmp(s, "MemTotal:", 8)) {
-		    MemTotal = atol(s + 9);
-		    ++n;
-		} else if (!strncmp(s, "MemFree:", 7)) {
-		    MemFree = atol(s + 8);
-		    ++n;
-		} else if (!strncmp(s, "Cached:", 6)) {
-		    Cached = atol(s + 7);
-		    ++n;
-		} else if (!strncmp(s, "SwapTotal:", 10)) {
-		    SwapTotal = atol(s + 11);
-		    ++n;
-		} else if (!strncmp(s, "SwapFree:", 9)) {
-		    SwapFree = atol(s + 10);
-		    ++n;
-		} else {
-		    // printf("%8.8s\n", s);
-		}
-		if (!(s = strchr(s + 6, '\n'))) {
-		    break;
-		}
-		++s;			// skip newline
-	    }
+    if (!*buf) {
+	if (!(*buf = malloc(16384 + 16))) {
+	    return -1;
 	}
-	close(fd);
+	*size = 16384;
+    }
+    while ((n = ReadFd(fd, *buf, *size)) == *size - 1) {
+	if (!(p = realloc(*buf, *size * 2 + 16))) {
+	    break;
+	}
+	*buf = p;
+	*size *= 2;
+    }
+    if (n >= 0) {
+	memset(*buf + n, 0, 16);
     }
     return n;
 }
 
 /**
-**	Get memory used.
+**	Get monotonic time.
 **
-**	@returns the amount of memory used in procent (0-100).
+**	@returns monotonic time in us.
 */
-int GetMemory(void)
+uint64_t GetUsTime(void)
 {
-    return (MemTotal - MemFree - Cached) / (MemTotal / 100);
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
 }
 
+// ------------------------------------------------------------------------- //
+// replay
+
+static char ProcRoot[PATH_MAX];		///< root of /proc and /sys, "" real
+static int ReplaySample;		///< current sample of the replay
+
 /**
-**	Get swap used.
+**	Path of a /proc or /sys file, below the replayed sample with -R.
 **
-**	@returns the amount of swap used in procent (0-100); -1 no swap.
+**	@param path	absolute path
+**
+**	@returns path to open, valid until the next call.
 */
-int GetSwap(void)
+const char *ProcPath(const char *path)
 {
-    if (SwapTotal) {
-	return (SwapTotal - SwapFree) / (SwapTotal / 100);
+    static char buf[PATH_MAX * 2];
+
+    if (!*ProcRoot) {
+	return path;
     }
-    return -1;
+    snprintf(buf, sizeof(buf), "%s%s", ProcRoot, path);
+    return buf;
 }
 
-// ------------------------------------------------------------------------- //
-
 /**
-**	Draw CPU graphs.
+**	Open a replay of recorded /proc samples.
 **
-**	@param loops		How many loops was collected
+**	The samples are the numbered subdirectories 0, 1, ... of the replay
+**	directory, each with the recorded files (0/proc/stat, ...).
+**
+**	@returns -1 if failures.
 */
-void DrawCpuGraphs(int loops)
+int ReplayOpen(void)
 {
-    int n;
-    int c;
-    int y;
-    int o;
-    int r;
+    char *dir;
 
-    //
-    //	    copy area to the left
-    //
-    xcb_copy_area(Connection, Pixmap, Pixmap, NormalGC, 7, 6, 6, 6, 48, 39);
+    if (!(dir = realpath(ReplayDir, NULL))) {
+	fprintf(stderr, "Can't open replay %s: %s\n", ReplayDir,
+	    strerror(errno));
+	return -1;
+    }
+    ReplayDir = dir;
+    snprintf(ProcRoot, sizeof(ProcRoot), "%s/0", ReplayDir);
+    if (access(ProcRoot, F_OK)) {
+	fprintf(stderr, "Can't open replay sample %s: %s\n", ProcRoot,
+	    strerror(errno));
+	return -1;
+    }
+    return 0;
+}
 
-    y = 6;
-    o = 40 / Cpus;
-    r = 40 % Cpus;
-    for (c = 0; c < Cpus; ++c) {
-	if (!r--) {			// no remainder reduce
-	    --o;
-	}
+/**
+**	Switch the open /proc and /sys files to the next recorded sample.
+**
+**	The files stay open at the same descriptors, the readers don't notice
+**	the switch.  After the last sample the replay restarts.
+*/
+void ReplayNext(void)
+{
+    char root[PATH_MAX];
+    char link[PATH_MAX];
+    char path[PATH_MAX * 2];
+    DIR *dir;
+    struct dirent *dirent;
+    size_t len;
+    ssize_t n;
+    int fd;
 
-	n = CpuInfo[c].AvgLoad / loops;
-	if (Logscale) {
-	    n = Log10[n];
-	}
-	// draw graph
-	n = o - ((o * n) / 100);
-	// draw only if size has changed
-	if (n != CpuInfo[c].OldAvgLoadSize) {
-	    CpuInfo[c].OldAvgLoadSize = n;
-	    if (n) {
-		xcb_copy_area(Connection, Image, Pixmap, NormalGC, 55, y, 54,
-		    y, 1, n);
+    snprintf(root, sizeof(root), "%s/%d", ReplayDir, ++ReplaySample);
+    if (access(root, F_OK)) {		// last sample, restart
+	ReplaySample = 0;
+	snprintf(root, sizeof(root), "%s/0", ReplayDir);
+    }
+    len = strlen(ProcRoot);
+    if ((dir = opendir("/proc/self/fd"))) {
+	while ((dirent = readdir(dir))) {
+	    snprintf(path, sizeof(path), "/proc/self/fd/%s", dirent->d_name);
+	    n = readlink(path, link, sizeof(link) - 1);
+	    if (n <= (ssize_t) len || strncmp(link, ProcRoot, len)
+		|| link[len] != '/') {
+		continue;
 	    }
-	    if (n != o) {
-		xcb_copy_area(Connection, Image, Pixmap, NormalGC, 64, 0, 54,
-		    y + n, 1, o - n);
+	    link[n] = '\0';
+	    snprintf(path, sizeof(path), "%s%s", root, link + len);
+	    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) >= 0) {
+		dup3(fd, atoi(dirent->d_name), O_CLOEXEC);
+		close(fd);
 	    }
 	}
-	CpuInfo[c].AvgLoad = 0;
-	y += o + 1;
+	closedir(dir);
     }
+    strcpy(ProcRoot, root);
 }
 
-/**
-**	Draw CPU bar
-*/
+// ------------------------------------------------------------------------- //
+// keyed "name value" files
+
+#define PROC_KEY_HASH 128		///< key hash table size (power of 2)
+
+    ///
+    /// value wanted from a "name value" file (/proc/meminfo, /proc/vmstat)
+    ///
+struct proc_key
+{
+    const char *Name;			///< name of the value
+    uint64_t *Value;			///< sum of all values with this name
+};
+
+    ///
+    /// hashed key table of a "name value" file
+    ///
+struct proc_keys
+{
+    const struct proc_key *Keys;	///< wanted keys, NULL terminated
+    uint8_t Hash[PROC_KEY_HASH];	///< hash slot -> key index + 1
+};
+
+/**
+**	Hash a key name.
+**
+**	@param s	key name
+**	@param[out] len	length of the name (upto ':', ' ' or end)
+*/
+static inline unsigned ProcKeyHash(const char *s, int *len)
+{
+    unsigned h;
+    int i;
+
+    h = 5381;
+    for (i = 0; s[i] && s[i] != ':' && s[i] != ' '; ++i) {
+	h = (h * 33) ^ (unsigned char)s[i];
+    }
+    *len = i;
+    return h;
+}
+
+/**
+**	Build the hash table of a key table.
+**
+**	@param keys	key table, with keys->Keys filled
+*/
+void ProcKeysInit(struct proc_keys *keys)
+{
+    int i;
+    int len;
+    unsigned h;
+
+    memset(keys->Hash, 0, sizeof(keys->Hash));
+    for (i = 0; keys->Keys[i].Name; ++i) {
+	h = ProcKeyHash(keys->Keys[i].Name, &len);
+	while (keys->Hash[h % PROC_KEY_HASH]) {	// linear probe
+	    ++h;
+	}
+	keys->Hash[h % PROC_KEY_HASH] = i + 1;
+    }
+}
+
+/**
+**	Parse a "name value" file in a single pass.
+**
+**	Each line is hashed once and looked up in the key table, instead of
+**	comparing it with every wanted key.  All wanted values are cleared
+**	first, values of keys sharing the same variable are summed up.
+**
+**	@param keys	hashed key table
+**	@param buf	'\0' terminated file contents
+**
+**	@returns number of keys found.
+*/
+int ProcKeysParse(const struct proc_keys *keys, const char *buf)
+{
+    const struct proc_key *key;
+    const char *s;
+    char *e;
+    unsigned h;
+    int len;
+    int n;
+    int i;
+
+    for (key = keys->Keys; key->Name; ++key) {
+	*key->Value = 0;
+    }
+    n = 0;
+    for (s = buf; *s;) {
+	h = ProcKeyHash(s, &len);
+	e = (char *)s + len;
+	for (; (i = keys->Hash[h % PROC_KEY_HASH]); ++h) {
+	    key = keys->Keys + i - 1;
+	    if (!strncmp(key->Name, s, len) && !key->Name[len]) {
+		*key->Value += strtoull(e + !!*e, &e, 10);
+		++n;
+		break;
+	    }
+	}
+	if (!(s = strchr(e, '\n'))) {
+	    break;
+	}
+	++s;				// skip newline
+    }
+    return n;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/stat
+
+    ///
+    /// collected data from /proc/stat
+    /// @see /usr/src/linux/Documentation/filesystems/proc.txt
+    ///
+struct cpu_info
+{
+    uint64_t Idle;			///< time cpu idle
+    uint64_t Used;			///< time cpu used
+    int Load;				///< cpu load
+    int History;			///< value for the history graph
+    int AvgLoad;			///< avg cpu load
+    int OldLoadSize;			///< old cpu load bar size
+    int OldAvgLoadSize;			///< old avg cpu load bar size
+} CpuInfo[MAX_CPUS];			///< cached cpu informations
+int Cpus;				///< number of cpus
+int Graphs;				///< number of history graphs, 0 = cpus
+
+static int StatFd = -1;			///< open /proc/stat
+static char *StatBuffer;		///< contents of /proc/stat
+static int StatBufferSize;		///< size of stat buffer
+static uint64_t Ctxt;			///< context switches
+static int ProcsRunning;		///< runnable tasks
+static int ProcsBlocked;		///< tasks blocked on I/O
+
+/**
+**	Read the complete stat file.
+**
+**	Caches the single values (ctxt, procs_running, procs_blocked), which
+**	follow the long intr line.
+**
+**	@returns number of bytes read, -1 if failures.
+*/
+int ReadStat(void)
+{
+    int n;
+    const char *s;
+
+    if (StatFd < 0
+	&& (StatFd = open(ProcPath("/proc/stat"), O_RDONLY | O_CLOEXEC)) < 0) {
+	return -1;
+    }
+    if ((n = ReadFdGrow(StatFd, &StatBuffer, &StatBufferSize)) > 0) {
+	if ((s = strstr(StatBuffer, "\nintr ")) && (s = strchr(s + 1, '\n'))) {
+	    while (*++s) {
+		if (!strncmp(s, "ctxt ", 5)) {
+		    Ctxt = strtoull(s + 5, NULL, 10);
+		} else if (!strncmp(s, "procs_running ", 14)) {
+		    ProcsRunning = atoi(s + 14);
+		} else if (!strncmp(s, "procs_blocked ", 14)) {
+		    ProcsBlocked = atoi(s + 14);
+		}
+		if (!*(s = strchrnul(s, '\n'))) {
+		    break;
+		}
+	    }
+	}
+    }
+    return n;
+}
+
+    ///
+    /// cpu nr. to bar mapping, compiled from -a, -c and -j
+    ///
+static struct cpu_row_info
+{
+    int First;				///< cpu of the first bar
+    int Shift;				///< log2 cpus per bar
+    int Mask;				///< 0 all cpus in the first bar
+} CpuRowMap;
+
+/**
+**	Compile the cpu selection options into the cpu to bar mapping.
+*/
+void CpuRowInit(void)
+{
+    CpuRowMap.First = AllCpus ? 0 : StartCpu;
+    CpuRowMap.Shift = JoinCpus;
+    CpuRowMap.Mask = AllCpus ? 0 : -1;
+}
+
+/**
+**	Get the bar of a cpu.
+**
+**	@param cpu	cpu nr.
+**
+**	@returns bar of the cpu, -1 if the cpu isn't shown.
+*/
+static inline int CpuRow(int cpu)
+{
+    int row;
+
+    row = ((cpu - CpuRowMap.First) >> CpuRowMap.Shift) & CpuRowMap.Mask;
+    return (unsigned)row < MAX_CPUS ? row : -1;
+}
+
+/**
+**	Read stat.
+**
+**	The cpu lines are summed into the bars with the cpu to bar mapping.
+**
+**	@returns -1 if failures, number of bars otherwise.
+*/
+int GetStat(void)
+{
+    uint64_t used[MAX_CPUS];
+    uint64_t idle[MAX_CPUS];
+    uint64_t total;
+    const char *s;
+    char *e;
+    int row;
+    int rows;
+
+    if (ReadStat() <= 0) {
+	return -1;
+    }
+    memset(used, 0, sizeof(used));
+    memset(idle, 0, sizeof(idle));
+    rows = 0;
+    // skip the first total cpu line, each line is "cpuN values\n"
+    for (s = StatBuffer; (s = strchr(s, '\n')) && !strncmp(++s, "cpu", 3);) {
+	if ((row = CpuRow(strtol(s + 3, &e, 10))) < 0) {
+	    continue;
+	}
+	// user nice system idle
+	used[row] += strtoull(e, &e, 10);
+	used[row] += strtoull(e, &e, 10);
+	used[row] += strtoull(e, &e, 10);
+	idle[row] += strtoull(e, &e, 10);
+	if (row >= rows) {
+	    rows = row + 1;
+	}
+    }
+
+    for (row = 0; row < rows; ++row) {
+	total = used[row] + idle[row] - CpuInfo[row].Used - CpuInfo[row].Idle;
+
+	CpuInfo[row].Load = 0;
+	if (total && used[row] > CpuInfo[row].Used) {
+	    CpuInfo[row].Load = (100 * (used[row] - CpuInfo[row].Used))
+		/ total;
+	    // idle and iowait can go backwards (NO_HZ)
+	    if (CpuInfo[row].Load > 100) {
+		CpuInfo[row].Load = 100;
+	    }
+	}
+	CpuInfo[row].History = CpuInfo[row].Load;
+	CpuInfo[row].Idle = idle[row];
+	CpuInfo[row].Used = used[row];
+    }
+    Cpus = rows ? rows : 1;
+
+    return rows;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/meminfo
+
+static uint64_t MemTotal;		///< cached memory info total memory
+static uint64_t MemFree;		///< cached memory info free memory
+static uint64_t MemAvailable;		///< cached memory info available memory
+static uint64_t Buffers;		///< cached memory info buffers
+static uint64_t Cached;			///< cached memory info cached memory
+static uint64_t SReclaimable;		///< cached memory info reclaimable slab
+static uint64_t Shmem;			///< cached memory info shared memory
+static uint64_t SwapFree;		///< cached memory info free swap
+static uint64_t SwapTotal;		///< cached memory info total swap
+static uint64_t Dirty;			///< cached memory info dirty pages
+static uint64_t Writeback;		///< cached memory info pages in writeback
+static uint64_t HugePagesTotal;		///< cached memory info huge pages
+static uint64_t HugePagesFree;		///< cached memory info free huge pages
+
+    /// wanted /proc/meminfo values
+static const struct proc_key MeminfoKey[] = {
+    {"MemTotal", &MemTotal},
+    {"MemFree", &MemFree},
+    {"MemAvailable", &MemAvailable},
+    {"Buffers", &Buffers},
+    {"Cached", &Cached},
+    {"SReclaimable", &SReclaimable},
+    {"Shmem", &Shmem},
+    {"SwapTotal", &SwapTotal},
+    {"SwapFree", &SwapFree},
+    {"Dirty", &Dirty},
+    {"Writeback", &Writeback},
+    {"HugePages_Total", &HugePagesTotal},
+    {"HugePages_Free", &HugePagesFree},
+    {NULL, NULL}
+};
+
+static struct proc_keys MeminfoKeys = { MeminfoKey, {0} };	///< hashed keys
+
+static int MeminfoFd = -1;		///< open /proc/meminfo
+
+    ///
+    /// memory accounting modes
+    ///
+enum mem_mode
+{
+    MEM_AVAILABLE,			///< MemTotal - MemAvailable
+    MEM_CLASSIC,			///< MemTotal - MemFree - Cached
+    MEM_FREE,				///< used like htop, shmem is used
+    MEM_HUGE_DIRTY,			///< huge pages and dirty/writeback
+};
+
+static enum mem_mode MemMode;		///< memory accounting mode
+
+/**
+**	Read meminfo.
+**
+**	@returns -1 if failures.
+*/
+int GetMeminfo(void)
+{
+    static char buf[8192];
+
+    if (MeminfoFd < 0) {
+	if ((MeminfoFd = open(ProcPath("/proc/meminfo"),
+		    O_RDONLY | O_CLOEXEC)) < 0) {
+	    return -1;
+	}
+	ProcKeysInit(&MeminfoKeys);
+    }
+    if (ReadFd(MeminfoFd, buf, sizeof(buf)) <= 0) {
+	return -1;
+    }
+    return ProcKeysParse(&MeminfoKeys, buf);
+}
+
+/**
+**	Get the dirty page limit.
+**
+**	@returns the dirty limit in kB, for vm.dirty_ratio of the available
+**	memory or vm.dirty_bytes.
+*/
+static uint64_t GetDirtyLimit(void)
+{
+    static int ratio;
+    static uint64_t bytes;
+    char buf[64];
+    int fd;
+
+    if (!ratio && !bytes) {		// read only once
+	ratio = 20;			// kernel default
+	if ((fd = open(ProcPath("/proc/sys/vm/dirty_bytes"), O_RDONLY)) >= 0) {
+	    if (ReadFd(fd, buf, sizeof(buf)) > 0) {
+		bytes = strtoull(buf, NULL, 10) >> 10;
+	    }
+	    close(fd);
+	}
+	if ((fd = open(ProcPath("/proc/sys/vm/dirty_ratio"), O_RDONLY)) >= 0) {
+	    if (ReadFd(fd, buf, sizeof(buf)) > 0) {
+		ratio = atoi(buf);
+	    }
+	    close(fd);
+	}
+    }
+    if (bytes) {
+	return bytes;
+    }
+    return ((MemAvailable ? MemAvailable : MemFree + Cached) * ratio) / 100;
+}
+
+/**
+**	Get memory used.
+**
+**	@returns the amount of memory used in procent (0-100).
+*/
+int GetMemory(void)
+{
+    int64_t used;
+
+    switch (MemMode) {
+	case MEM_AVAILABLE:
+	    if (MemAvailable) {
+		used = MemTotal - MemAvailable;
+		break;
+	    }
+	    // kernel without MemAvailable
+	    /* fallthrough */
+	case MEM_FREE:
+	    used = MemTotal - MemFree - Buffers - Cached - SReclaimable + Shmem;
+	    break;
+	case MEM_CLASSIC:
+	    used = MemTotal - MemFree - Cached;
+	    break;
+	case MEM_HUGE_DIRTY:
+	    if (HugePagesTotal) {
+		return (100 * (HugePagesTotal - HugePagesFree))
+		    / HugePagesTotal;
+	    }
+	    return 0;
+	default:
+	    used = 0;
+	    break;
+    }
+    if (used <= 0 || !MemTotal) {
+	return 0;
+    }
+    if ((uint64_t) used >= MemTotal) {
+	return 100;
+    }
+    return (100 * used) / MemTotal;
+}
+
+/**
+**	Get swap used.
+**
+**	@returns the amount of swap used in procent (0-100); -1 no swap.
+*/
+int GetSwap(void)
+{
+    uint64_t limit;
+
+    if (MemMode == MEM_HUGE_DIRTY) {	// dirty + writeback against limit
+	if ((limit = GetDirtyLimit())) {
+	    if (Dirty + Writeback >= limit) {
+		return 100;
+	    }
+	    return (100 * (Dirty + Writeback)) / limit;
+	}
+	return 0;
+    }
+    if (SwapTotal) {
+	return (100 * (SwapTotal - SwapFree)) / SwapTotal;
+    }
+    return -1;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/vmstat
+
+static uint64_t PageSwap;		///< pages swapped in and out
+static uint64_t MajorFaults;		///< major page faults
+static uint64_t PageScan;		///< pages scanned by reclaim
+static uint64_t PageSteal;		///< pages reclaimed
+
+    /// wanted /proc/vmstat values
+static const struct proc_key VmstatKey[] = {
+    {"pswpin", &PageSwap},
+    {"pswpout", &PageSwap},
+    {"pgmajfault", &MajorFaults},
+    {"pgscan_kswapd", &PageScan},
+    {"pgscan_direct", &PageScan},
+    {"pgscan_khugepaged", &PageScan},
+    {"pgscan_proactive", &PageScan},
+    {"pgsteal_kswapd", &PageSteal},
+    {"pgsteal_direct", &PageSteal},
+    {"pgsteal_khugepaged", &PageSteal},
+    {"pgsteal_proactive", &PageSteal},
+    {NULL, NULL}
+};
+
+static struct proc_keys VmstatKeys = { VmstatKey, {0} };	///< hashed keys
+
+static int VmstatFd = -1;		///< open /proc/vmstat
+
+    ///
+    /// paging rates from /proc/vmstat
+    ///
+static struct vmstat_info
+{
+    uint64_t Swap;			///< swap in + out pages per second
+    uint64_t Faults;			///< major faults per second
+    uint64_t Scan;			///< reclaim scanned pages per second
+    uint64_t Steal;			///< reclaimed pages per second
+} Vmstat;
+
+/**
+**	Read vmstat and calculate the paging rates.
+**
+**	@returns -1 if failures.
+*/
+int GetVmstat(void)
+{
+    static char buf[8192];
+    static uint64_t old_swap;
+    static uint64_t old_faults;
+    static uint64_t old_scan;
+    static uint64_t old_steal;
+    static uint64_t old_time;
+    uint64_t now;
+    uint64_t dt;
+    int n;
+
+    if (VmstatFd < 0) {
+	if ((VmstatFd = open(ProcPath("/proc/vmstat"),
+		    O_RDONLY | O_CLOEXEC)) < 0) {
+	    return -1;
+	}
+	ProcKeysInit(&VmstatKeys);
+    }
+    if (ReadFd(VmstatFd, buf, sizeof(buf)) <= 0) {
+	return -1;
+    }
+    n = ProcKeysParse(&VmstatKeys, buf);
+    now = GetUsTime();
+
+    if (old_time && (dt = now - old_time)) {
+	Vmstat.Swap = ((PageSwap - old_swap) * 1000000) / dt;
+	Vmstat.Faults = ((MajorFaults - old_faults) * 1000000) / dt;
+	Vmstat.Scan = ((PageScan - old_scan) * 1000000) / dt;
+	Vmstat.Steal = ((PageSteal - old_steal) * 1000000) / dt;
+    }
+    old_swap = PageSwap;
+    old_faults = MajorFaults;
+    old_scan = PageScan;
+    old_steal = PageSteal;
+    old_time = now;
+
+    return n;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/pressure
+
+#define PSI_BACKGROUND	8		///< memory refresh slowdown with psi
+
+    ///
+    /// pressure stall information of memory and cpu
+    ///
+static struct psi_info
+{
+    int Fd[2];				///< open memory, cpu pressure files
+    char Trigger[2];			///< stall trigger registered
+    int Some[2];			///< some avg10 in percent, -1 none
+} Psi = { {-1, -1}, {0, 0}, {-1, -1} };
+
+static int MemInterval = 10;		///< memory refresh in ticks
+
+/**
+**	Open the pressure files and register the stall triggers.
+**
+**	A trigger fires, when some tasks stall 150 ms in a 2 s window.  The
+**	2 s window is also allowed for unprivileged users (linux 6.5), before
+**	or without PSI support the files are only read or missing.
+**
+**	@returns true if the memory trigger is registered.
+*/
+int PsiOpen(void)
+{
+    static const char *const names[] = { "/proc/pressure/memory",
+	"/proc/pressure/cpu"
+    };
+    static const char trigger[] = "some 150000 2000000";
+    int i;
+
+    for (i = 0; i < 2; ++i) {
+	if ((Psi.Fd[i] = open(ProcPath(names[i]),
+		    O_RDWR | O_NONBLOCK | O_CLOEXEC)) >= 0) {
+	    // trigger includes the terminating nul
+	    Psi.Trigger[i] = write(Psi.Fd[i], trigger, sizeof(trigger))
+		== sizeof(trigger);
+	} else {
+	    Psi.Fd[i] = open(ProcPath(names[i]), O_RDONLY | O_CLOEXEC);
+	}
+    }
+    return Psi.Trigger[0];
+}
+
+/**
+**	Fill the poll descriptors of the stall triggers.
+**
+**	@param fds	two poll descriptors, unused are -1
+**
+**	@returns number of filled poll descriptors.
+*/
+int PsiPollFds(struct pollfd *fds)
+{
+    int i;
+
+    for (i = 0; i < 2; ++i) {
+	fds[i].fd = Psi.Trigger[i] ? Psi.Fd[i] : -1;
+	fds[i].events = POLLPRI;
+	fds[i].revents = 0;
+    }
+    return 2;
+}
+
+/**
+**	Read the pressure files.
+**
+**	@returns 0.
+*/
+int PsiRead(void)
+{
+    char buf[256];
+    const char *s;
+    int i;
+
+    for (i = 0; i < 2; ++i) {
+	Psi.Some[i] = -1;
+	if (Psi.Fd[i] >= 0 && ReadFd(Psi.Fd[i], buf, sizeof(buf)) > 0
+	    && (s = strstr(buf, "some avg10="))) {
+	    Psi.Some[i] = atoi(s + sizeof("some avg10=") - 1);
+	}
+    }
+    return 0;
+}
+
+/**
+**	Get memory pressure.
+**
+**	@returns the time some tasks stall on memory in procent (0-100); -1
+**	no pressure stall information.
+*/
+int GetMemoryPressure(void)
+{
+    return Psi.Some[0];
+}
+
+/**
+**	Get cpu pressure.
+**
+**	@returns the time some tasks wait for a cpu in procent (0-100); -1
+**	no pressure stall information.
+*/
+int GetCpuPressure(void)
+{
+    return Psi.Some[1];
+}
+
+// ------------------------------------------------------------------------- //
+// cgroup v2
+
+#define CGROUP_DEPTH 16			///< max. nested cgroups handled
+
+    ///
+    /// open files of the monitored cgroup v2 directory
+    /// @see /usr/src/linux/Documentation/admin-guide/cgroup-v2.rst
+    ///
+static struct cgroup_info
+{
+    int CpuStat;			///< cpu.stat
+    int MemoryCurrent;			///< memory.current
+    int SwapCurrent;			///< memory.swap.current
+    int CpuMax[CGROUP_DEPTH + 1];	///< cpu.max of cgroup + ancestors
+    int MemoryMax[CGROUP_DEPTH + 1];	///< memory.max of cgroup + ancestors
+    int SwapMax[CGROUP_DEPTH + 1];	///< memory.swap.max of ... ancestors
+    int Cpus;				///< cpus in cpuset.cpus.effective
+    uint64_t Capacity;			///< effective cpu quota in 1/1000 cpus
+    uint64_t Usage;			///< last usage_usec
+    uint64_t Time;			///< time of last usage_usec in us
+} Cgroup;
+
+/**
+**	Count cpus of a cpu list ("0-3,8,10-11").
+**
+**	@param s	cpu list
+**	@param set	if not NULL, add the cpus to this set
+**
+**	@returns number of cpus in the list.
+*/
+int CountCpuList(const char *s, cpu_set_t * set)
+{
+    int n;
+    char *e;
+    long first;
+    long last;
+
+    n = 0;
+    while (isdigit(*s)) {
+	first = last = strtol(s, &e, 10);
+	if (*e == '-') {
+	    last = strtol(e + 1, &e, 10);
+	}
+	if (last >= first) {
+	    n += last - first + 1;
+	    for (; set && first <= last && first < CPU_SETSIZE; ++first) {
+		CPU_SET(first, set);
+	    }
+	}
+	if (*e != ',') {
+	    break;
+	}
+	s = e + 1;
+    }
+    return n;
+}
+
+/**
+**	Read a cgroup value, "max" is returned as unlimited.
+**
+**	@param fd	open cgroup file
+**	@param[out] period	second value of the file (cpu.max), can be NULL
+**
+**	@returns the value, UINT64_MAX for "max" or failures.
+*/
+static uint64_t CgroupValue(int fd, uint64_t * period)
+{
+    char buf[64];
+    char *s;
+    uint64_t value;
+
+    if (ReadFd(fd, buf, sizeof(buf)) <= 0 || !isdigit(*buf)) {
+	return UINT64_MAX;
+    }
+    value = strtoull(buf, &s, 10);
+    if (period) {
+	*period = strtoull(s, NULL, 10);
+    }
+    return value;
+}
+
+/**
+**	Get the smallest limit of a cgroup and its ancestors.
+**
+**	@param fds	-1 terminated descriptors of the limit files
+**
+**	@returns the effective limit, UINT64_MAX if unlimited.
+*/
+static uint64_t CgroupLimit(const int *fds)
+{
+    uint64_t limit;
+    uint64_t value;
+
+    limit = UINT64_MAX;
+    for (; *fds >= 0; ++fds) {
+	if ((value = CgroupValue(*fds, NULL)) < limit) {
+	    limit = value;
+	}
+    }
+    return limit;
+}
+
+/**
+**	Open a cgroup file.
+**
+**	@param dir	cgroup directory
+**	@param name	file name in the cgroup directory
+**
+**	@returns file descriptor, -1 if failures.
+*/
+static int CgroupOpenFile(const char *dir, const char *name)
+{
+    char path[PATH_MAX];
+
+    if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) {
+	errno = ENAMETOOLONG;
+	return -1;
+    }
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+/**
+**	Update the effective cpu quota.
+**
+**	The smallest quota/period of the cgroup and its ancestors, limited by
+**	the cpus of the cgroup.
+*/
+static void CgroupCapacity(void)
+{
+    uint64_t quota;
+    uint64_t period;
+    uint64_t capacity;
+    const int *fds;
+
+    capacity = Cgroup.Cpus * 1000ULL;
+    for (fds = Cgroup.CpuMax; *fds >= 0; ++fds) {
+	quota = CgroupValue(*fds, &period);
+	if (quota != UINT64_MAX && period
+	    && (quota * 1000) / period < capacity) {
+	    capacity = (quota * 1000) / period;
+	}
+    }
+    Cgroup.Capacity = capacity ? capacity : 1;
+}
+
+/**
+**	Read cgroup cpu usage.
+**
+**	Utilization is usage_usec against the effective cpu.max quota, which
+**	is updated every 10th call.
+**
+**	@returns -1 if failures.
+*/
+int GetCgroupStat(void)
+{
+    static int loops;
+    char buf[256];
+    const char *s;
+    uint64_t usage;
+    uint64_t now;
+    uint64_t total;
+
+    if (++loops == 10) {		// quota changes are rare
+	CgroupCapacity();
+	loops = 0;
+    }
+    Cpus = 1;
+    if (ReadFd(Cgroup.CpuStat, buf, sizeof(buf)) <= 0
+	|| !(s = strstr(buf, "usage_usec "))) {
+	return -1;
+    }
+    usage = strtoull(s + sizeof("usage_usec ") - 1, NULL, 10);
+    now = GetUsTime();
+
+    total = (now - Cgroup.Time) * Cgroup.Capacity;
+    CpuInfo[0].Load = 0;
+    if (Cgroup.Time && total && usage > Cgroup.Usage) {
+	CpuInfo[0].Load = (100 * 1000 * (usage - Cgroup.Usage)) / total;
+	if (CpuInfo[0].Load > 100) {
+	    CpuInfo[0].Load = 100;
+	}
+    }
+    CpuInfo[0].History = CpuInfo[0].Load;
+    Cgroup.Usage = usage;
+    Cgroup.Time = now;
+
+    return 1;
+}
+
+/**
+**	Read cgroup memory and the effective limits.
+**
+**	The values are stored into the /proc/meminfo cache, unlimited memory
+**	or swap is limited by the system total.  Without memory.current (root
+**	cgroup, memory controller not enabled) the system memory is shown.
+**
+**	@returns -1 if failures.
+*/
+int GetCgroupMeminfo(void)
+{
+    uint64_t limit;
+    uint64_t value;
+    static uint64_t mem_total;
+    static uint64_t swap_total;
+
+    if (Cgroup.MemoryCurrent < 0) {
+	return GetMeminfo();
+    }
+    if (!mem_total) {			// system totals from /proc/meminfo
+	mem_total = MemTotal;
+	swap_total = SwapTotal;
+    }
+
+    limit = CgroupLimit(Cgroup.MemoryMax) >> 10;
+    if (limit > mem_total) {
+	limit = mem_total;
+    }
+    value = CgroupValue(Cgroup.MemoryCurrent, NULL) >> 10;
+    if (value > limit) {
+	value = limit;
+    }
+    MemTotal = limit;
+    MemFree = limit - value;
+    MemAvailable = MemFree;
+    Buffers = Cached = SReclaimable = Shmem = 0;
+
+    SwapTotal = 0;
+    SwapFree = 0;
+    if (Cgroup.SwapCurrent >= 0) {
+	limit = CgroupLimit(Cgroup.SwapMax) >> 10;
+	if (limit > swap_total) {
+	    limit = swap_total;
+	}
+	value = CgroupValue(Cgroup.SwapCurrent, NULL) >> 10;
+	if (value > limit) {
+	    value = limit;
+	}
+	SwapTotal = limit;
+	SwapFree = limit - value;
+    }
+
+    return 0;
+}
+
+/**
+**	Open the files of the monitored cgroup.
+**
+**	The limit files are opened for the cgroup and all its ancestors, the
+**	root cgroup has no limit files.  The directory is made absolute
+**	first, for the walk up to the root.
+**
+**	@param dir	cgroup v2 directory
+**
+**	@returns -1 if failures.
+*/
+int CgroupOpen(const char *dir)
+{
+    char path[PATH_MAX];
+    char buf[1024];
+    char *s;
+    int fd;
+    int i;
+    int c;
+    int m;
+    int w;
+
+    if (!realpath(dir, path)
+	|| (Cgroup.CpuStat = CgroupOpenFile(path, "cpu.stat")) < 0) {
+	fprintf(stderr, "Can't open cgroup %s: %s\n", dir, strerror(errno));
+	return -1;
+    }
+    dir = path;
+    Cgroup.MemoryCurrent = CgroupOpenFile(dir, "memory.current");
+    Cgroup.SwapCurrent = CgroupOpenFile(dir, "memory.swap.current");
+
+    Cgroup.Cpus = 0;
+    if ((fd = CgroupOpenFile(dir, "cpuset.cpus.effective")) >= 0) {
+	if (ReadFd(fd, buf, sizeof(buf)) > 0) {
+	    Cgroup.Cpus = CountCpuList(buf, NULL);
+	}
+	close(fd);
+    }
+    if (!Cgroup.Cpus) {
+	Cgroup.Cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    //
+    //	walk up to the root cgroup, collect the limit files
+    //
+    c = m = w = 0;
+    for (i = 0; i < CGROUP_DEPTH; ++i) {
+	if ((fd = CgroupOpenFile(path, "cpu.max")) >= 0) {
+	    Cgroup.CpuMax[c++] = fd;
+	}
+	if ((fd = CgroupOpenFile(path, "memory.max")) >= 0) {
+	    Cgroup.MemoryMax[m++] = fd;
+	}
+	if ((fd = CgroupOpenFile(path, "memory.swap.max")) >= 0) {
+	    Cgroup.SwapMax[w++] = fd;
+	}
+	if (!(s = strrchr(path, '/')) || s == path) {
+	    break;
+	}
+	*s = '\0';
+    }
+    Cgroup.CpuMax[c] = -1;
+    Cgroup.MemoryMax[m] = -1;
+    Cgroup.SwapMax[w] = -1;
+
+    CgroupCapacity();
+    GetMeminfo();			// for unlimited memory and swap
+    GetCgroupMeminfo();
+
+    return 0;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/diskstats
+
+    ///
+    /// collected data of a disk from /proc/diskstats
+    /// @see /usr/src/linux/Documentation/admin-guide/iostats.rst
+    ///
+static struct disk_info
+{
+    char Name[32];			///< device name
+    uint64_t Sectors;			///< sectors read + written
+    uint64_t Ticks;			///< time spent doing I/Os in ms
+    uint64_t Peak;			///< auto scale peak throughput
+} DiskInfo[MAX_CPUS];			///< monitored disks
+static int Disks;			///< number of monitored disks
+
+static int DiskstatsFd = -1;		///< open /proc/diskstats
+
+/**
+**	Scale a rate to 0-100 against a slowly decaying peak.
+**
+**	@param peak	auto scale peak, updated
+**	@param rate	rate to scale
+**	@param floor	smallest peak, rates below are near zero
+**
+**	@returns the rate in procent of the peak.
+*/
+int AutoScale(uint64_t * peak, uint64_t rate, uint64_t floor)
+{
+    *peak -= *peak >> 6;		// forget the peak in ~64 samples
+    if (*peak < floor) {
+	*peak = floor;
+    }
+    if (rate > *peak) {
+	*peak = rate;
+    }
+    return (100 * rate) / *peak;
+}
+
+/**
+**	Compare disk names for sort.
+*/
+static int DiskCompare(const void *a, const void *b)
+{
+    return strcmp(((const struct disk_info *)a)->Name,
+	((const struct disk_info *)b)->Name);
+}
+
+/**
+**	Select the disks to monitor.
+**
+**	@param list	comma separated device names or "all" for the first
+**			whole disks by name (block devices with a backing
+**			device)
+**
+**	@returns -1 if failures.
+*/
+int DiskOpen(const char *list)
+{
+    char path[PATH_MAX];
+    const char *s;
+    struct dirent *dirent;
+    DIR *dir;
+    struct disk_info *all;
+    int size;
+    int n;
+
+    Disks = 0;
+    if (!strcmp(list, "all")) {
+	// collect all disks, the first by name are monitored
+	all = NULL;
+	size = n = 0;
+	if ((dir = opendir(ProcPath("/sys/block")))) {
+	    while ((dirent = readdir(dir))) {
+		snprintf(path, sizeof(path), "/sys/block/%s/device",
+		    dirent->d_name);
+		if (dirent->d_name[0] == '.'
+		    || access(ProcPath(path), F_OK)) {
+		    continue;
+		}
+		if (strlen(dirent->d_name) >= sizeof(all->Name)) {
+		    fprintf(stderr, "Disk name '%s' too long, skipped\n",
+			dirent->d_name);
+		    continue;
+		}
+		if (n == size) {
+		    size = size ? size * 2 : 16;
+		    if (!(all = realloc(all, size * sizeof(*all)))) {
+			fprintf(stderr, "Out of memory\n");
+			closedir(dir);
+			return -1;
+		    }
+		}
+		memset(all + n, 0, sizeof(*all));
+		strcpy(all[n++].Name, dirent->d_name);
+	    }
+	    closedir(dir);
+	}
+	qsort(all, n, sizeof(*all), DiskCompare);
+	Disks = n < MAX_CPUS ? n : MAX_CPUS;
+	if (Disks) {
+	    memcpy(DiskInfo, all, Disks * sizeof(*all));
+	}
+	free(all);
+    } else {
+	for (s = list; *s && Disks < MAX_CPUS; s += n + !!s[n]) {
+	    n = strcspn(s, ",");
+	    if (n >= (int)sizeof(DiskInfo->Name)) {
+		fprintf(stderr, "Disk name '%.*s' too long, skipped\n", n, s);
+	    } else if (n) {
+		memcpy(DiskInfo[Disks].Name, s, n);
+		DiskInfo[Disks++].Name[n] = '\0';
+	    }
+	}
+    }
+    if (!Disks) {
+	fprintf(stderr, "No disks to monitor in '%s'\n", list);
+	return -1;
+    }
+    if ((DiskstatsFd = open(ProcPath("/proc/diskstats"),
+		O_RDONLY | O_CLOEXEC)) < 0) {
+	fprintf(stderr, "Can't open /proc/diskstats: %s\n", strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+/**
+**	Read diskstats.
+**
+**	Bar shows the utilization (io_ticks), history shows the throughput
+**	(sectors read + written) against the recent peak.
+**
+**	@returns -1 if failures.
+*/
+int GetDiskstats(void)
+{
+    static char *buf;
+    static int size;
+    static uint64_t old_time;
+    uint64_t now;
+    uint64_t dt;
+    const char *s;
+    char *e;
+    int i;
+    int n;
+    int len;
+    uint64_t v[10];
+
+    if (ReadFdGrow(DiskstatsFd, &buf, &size) <= 0) {
+	return -1;
+    }
+    now = GetUsTime();
+    dt = now - old_time;
+
+    n = 0;
+    for (s = buf; *s;) {
+	// each line is "major minor name values...\n"
+	strtoul(s, &e, 10);
+	strtoul(e, &e, 10);
+	s = e + strspn(e, " ");
+	len = strcspn(s, " \n");
+	for (i = 0; i < Disks; ++i) {
+	    if (!strncmp(DiskInfo[i].Name, s, len) && !DiskInfo[i].Name[len]) {
+		break;
+	    }
+	}
+	if (i < Disks) {
+	    int j;
+	    uint64_t sectors;
+	    struct disk_info *disk;
+
+	    e = (char *)s + len;
+	    for (j = 0; j < 10; ++j) {
+		v[j] = strtoull(e, &e, 10);
+	    }
+	    // 2: sectors read 6: sectors written 9: io_ticks
+	    sectors = v[2] + v[6];
+	    disk = DiskInfo + i;
+	    CpuInfo[i].Load = 0;
+	    CpuInfo[i].History = 0;
+	    if (old_time && dt) {
+		if (v[9] > disk->Ticks) {
+		    CpuInfo[i].Load = (100 * 1000 * (v[9] - disk->Ticks)) / dt;
+		    if (CpuInfo[i].Load > 100) {
+			CpuInfo[i].Load = 100;
+		    }
+		}
+		CpuInfo[i].History =
+		    AutoScale(&disk->Peak,
+		    ((sectors - disk->Sectors) * 512 * 1000000) / dt,
+		    1024 * 1024);
+	    }
+	    disk->Sectors = sectors;
+	    disk->Ticks = v[9];
+	    ++n;
+	}
+	if (!(s = strchr(s, '\n'))) {
+	    break;
+	}
+	++s;				// skip newline
+    }
+    old_time = now;
+    Cpus = Disks;
+
+    return n;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/net/dev
+
+#define MAX_NETS 8			///< how many interfaces are supported
+
+    ///
+    /// collected data of an interface from /proc/net/dev
+    ///
+static struct net_info
+{
+    char Name[16];			///< interface name
+    uint64_t Rx;			///< received bytes
+    uint64_t Tx;			///< transmitted bytes
+} NetInfo[MAX_NETS];			///< monitored interfaces
+static int Nets;			///< number of monitored interfaces,
+					///< 0 all except loopback
+static uint64_t NetPeak[2];		///< auto scale peak of rx, tx
+
+static int NetDevFd = -1;		///< open /proc/net/dev
+
+/**
+**	Difference of two counter values.
+**
+**	Handles the wrap of 32 bit counters, which 32 bit kernels export.
+**	Any other decrease is a reset (f.e. interface re-created) and gives
+**	no difference, a spike would pin the auto scale peak.
+**
+**	@param value	new counter value
+**	@param old	old counter value
+*/
+static inline uint64_t CounterDelta(uint64_t value, uint64_t old)
+{
+    uint64_t delta;
+
+    if (value >= old) {
+	return value - old;
+    }
+    // 32 bit counter wrap, only when the old value was near 2^32
+    delta = value + (UINT32_MAX - old) + 1;
+    if (old <= UINT32_MAX && delta < 1ULL << 30) {
+	return delta;
+    }
+    return 0;
+}
+
+/**
+**	Select the interfaces to monitor.
+**
+**	@param list	comma separated interface names or "all" for all
+**			interfaces except loopback
+**
+**	@returns -1 if failures.
+*/
+int NetOpen(const char *list)
+{
+    const char *s;
+    int n;
+
+    Nets = 0;
+    if (strcmp(list, "all")) {
+	for (s = list; *s && Nets < MAX_NETS; s += n + !!s[n]) {
+	    n = strcspn(s, ",");
+	    if (n && n < (int)sizeof(NetInfo->Name)) {
+		memcpy(NetInfo[Nets].Name, s, n);
+		NetInfo[Nets++].Name[n] = '\0';
+	    }
+	}
+	if (!Nets) {
+	    fprintf(stderr, "No interfaces to monitor in '%s'\n", list);
+	    return -1;
+	}
+    }
+    if ((NetDevFd = open(ProcPath("/proc/net/dev"),
+		O_RDONLY | O_CLOEXEC)) < 0) {
+	fprintf(stderr, "Can't open /proc/net/dev: %s\n", strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+/**
+**	Read net/dev.
+**
+**	The first bar shows the received, the second the transmitted bytes
+**	per second of all monitored interfaces, against the recent peak.
+**
+**	@returns -1 if failures.
+*/
+int GetNetDev(void)
+{
+    static char *buf;
+    static int size;
+    static uint64_t old_time;
+    uint64_t now;
+    uint64_t dt;
+    uint64_t rx;
+    uint64_t tx;
+    uint64_t rx_bytes;
+    uint64_t tx_bytes;
+    const char *s;
+    char *e;
+    int i;
+    int j;
+    int n;
+    int len;
+
+    if (ReadFdGrow(NetDevFd, &buf, &size) <= 0) {
+	return -1;
+    }
+    now = GetUsTime();
+
+    rx_bytes = 0;
+    tx_bytes = 0;
+    n = 0;
+    // skip the two header lines
+    if ((s = strchr(buf, '\n')) && (s = strchr(s + 1, '\n'))) {
+	while (*++s) {
+	    // each line is "name: rx values(8) tx values(8)\n"
+	    s += strspn(s, " ");
+	    len = strcspn(s, ":\n");
+	    if (s[len] != ':') {
+		break;
+	    }
+	    if (Nets) {
+		for (i = 0; i < Nets; ++i) {
+		    if (!strncmp(NetInfo[i].Name, s, len)
+			&& !NetInfo[i].Name[len]) {
+			break;
+		    }
+		}
+	    } else if (len == 2 && !strncmp(s, "lo", 2)) {
+		i = MAX_NETS;		// skip loopback
+	    } else {			// find or add interface
+		for (i = 0; i < MAX_NETS && NetInfo[i].Name[0]; ++i) {
+		    if (!strncmp(NetInfo[i].Name, s, len)
+			&& !NetInfo[i].Name[len]) {
+			break;
+		    }
+		}
+		if (i < MAX_NETS && !NetInfo[i].Name[0]
+		    && len < (int)sizeof(NetInfo->Name)) {
+		    memcpy(NetInfo[i].Name, s, len);
+		    NetInfo[i].Name[len] = '\0';
+		    NetInfo[i].Rx = NetInfo[i].Tx = 0;
+		    old_time = 0;	// new interface, restart rates
+		}
+	    }
+	    e = (char *)s + len + 1;
+	    if (i < MAX_NETS && NetInfo[i].Name[0]) {
+		rx = strtoull(e, &e, 10);
+		for (j = 0; j < 7; ++j) {	// skip rx packets ... multicast
+		    strtoull(e, &e, 10);
+		}
+		tx = strtoull(e, &e, 10);
+		rx_bytes += CounterDelta(rx, NetInfo[i].Rx);
+		tx_bytes += CounterDelta(tx, NetInfo[i].Tx);
+		NetInfo[i].Rx = rx;
+		NetInfo[i].Tx = tx;
+		++n;
+	    }
+	    if (!(s = strchr(e, '\n'))) {
+		break;
+	    }
+	}
+    }
+
+    Cpus = 2;
+    CpuInfo[0].Load = 0;
+    CpuInfo[1].Load = 0;
+    if (old_time && (dt = now - old_time)) {
+	// 1 kB/s is the smallest full scale
+	CpuInfo[0].Load =
+	    AutoScale(&NetPeak[0], (rx_bytes * 1000000) / dt, 1024);
+	CpuInfo[1].Load =
+	    AutoScale(&NetPeak[1], (tx_bytes * 1000000) / dt, 1024);
+    }
+    CpuInfo[0].History = CpuInfo[0].Load;
+    CpuInfo[1].History = CpuInfo[1].Load;
+    old_time = now;
+
+    return n;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/interrupts /proc/softirqs
+
+    ///
+    /// interrupt rates of all cpus from /proc/interrupts and /proc/softirqs
+    ///
+static struct irq_info
+{
+    int Fd[2];				///< open /proc/interrupts, softirqs
+    char *Buffer;			///< read buffer (+16 bytes slack)
+    int BufferSize;			///< size of the read buffer
+    int Cpus;				///< size of the per cpu arrays
+    int Online;				///< cpus in /proc/interrupts
+    int *Column;			///< column -> cpu number
+    uint64_t *Count;			///< interrupts + softirqs per cpu
+    uint64_t *OldCount;			///< last interrupts + softirqs
+    uint64_t *Rate;			///< interrupts per second per cpu
+    int Top[MAX_CPUS];			///< the hottest cpus
+    int OldTop[MAX_CPUS];		///< hottest cpus of the labels
+    uint64_t Peak;			///< auto scale peak rate
+    uint64_t Time;			///< time of last sample
+    int Cost;				///< avg. parse cost in 1/16 us
+    int Skip;				///< ticks to skip until next parse
+} Irq;
+
+/**
+**	Open the interrupt files.
+**
+**	@returns -1 if failures.
+*/
+int IrqOpen(void)
+{
+    int n;
+
+    Irq.Fd[0] = open(ProcPath("/proc/interrupts"), O_RDONLY | O_CLOEXEC);
+    Irq.Fd[1] = open(ProcPath("/proc/softirqs"), O_RDONLY | O_CLOEXEC);
+    if (Irq.Fd[0] < 0) {
+	fprintf(stderr, "Can't open /proc/interrupts: %s\n", strerror(errno));
+	return -1;
+    }
+    if ((n = sysconf(_SC_NPROCESSORS_CONF)) < 1) {
+	n = 1;
+    }
+    Irq.Cpus = n;
+    Irq.Column = malloc(n * sizeof(*Irq.Column));
+    Irq.Count = calloc(n, sizeof(*Irq.Count));
+    Irq.OldCount = calloc(n, sizeof(*Irq.OldCount));
+    Irq.Rate = calloc(n, sizeof(*Irq.Rate));
+    if (!Irq.Column || !Irq.Count || !Irq.OldCount || !Irq.Rate) {
+	fprintf(stderr, "Out of memory\n");
+	return -1;
+    }
+    return 0;
+}
+
+/**
+**	Parse the per cpu columns of an interrupt line.
+**
+**	The columns are right aligned numbers with a lot of padding.  With
+**	SSE2 16 bytes are classified at once, padding is skipped in a single
+**	step and only the digits are handled bytewise.
+**
+**	@param s	line after the "name:"
+**	@param n	number of cpu columns
+**	@param[in,out] count	counters indexed by cpu, columns are added
+**
+**	@returns pointer to the end of the line.
+*/
+static const char *IrqParseColumns(const char *s, int n, uint64_t * count)
+{
+    const int *column;
+    uint64_t value;
+    int digits;
+
+    column = Irq.Column;
+    value = 0;
+    digits = 0;
+#ifdef __SSE2__
+    const __m128i before_0 = _mm_set1_epi8('0' - 1);
+    const __m128i after_9 = _mm_set1_epi8('9' + 1);
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i nul = _mm_setzero_si128();
+
+    for (;;) {
+	__m128i c;
+	unsigned d;
+	unsigned e;
+	unsigned p;
+	unsigned run;
+
+	c = _mm_loadu_si128((const __m128i *)s);
+	d = _mm_movemask_epi8(_mm_and_si128(_mm_cmpgt_epi8(c, before_0),
+		_mm_cmplt_epi8(c, after_9)));
+	e = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, newline),
+		_mm_cmpeq_epi8(c, nul)));
+	if (e) {			// only digits before end of line
+	    d &= (1U << __builtin_ctz(e)) - 1;
+	}
+	for (p = 0; p < 16;) {
+	    if (!(d >> p) || !((d >> p) & 1)) {	// non-digit ends number
+		if (digits) {
+		    count[*column++] += value;
+		    value = 0;
+		    digits = 0;
+		    if (!--n) {
+			return strchrnul(s + p, '\n');
+		    }
+		}
+		if (!(d >> p)) {
+		    break;
+		}
+		p += __builtin_ctz(d >> p);
+	    }
+	    run = __builtin_ctz(~(d >> p));
+	    for (run += p; p < run; ++p) {
+		value = value * 10 + s[p] - '0';
+	    }
+	    digits = 1;
+	}
+	if (e) {
+	    if (digits) {
+		count[*column] += value;
+	    }
+	    return s + __builtin_ctz(e);
+	}
+	s += 16;
+    }
+#else
+    char *e;
+
+    (void)value;
+    (void)digits;
+    for (; n; --n) {
+	s += strspn(s, " ");
+	if (!isdigit(*s)) {
+	    break;
+	}
+	count[*column++] += strtoull(s, &e, 10);
+	s = e;
+    }
+    return strchrnul(s, '\n');
+#endif
+}
+
+/**
+**	Parse an interrupt file.
+**
+**	@param buf	'\0' terminated file contents
+**	@param[in,out] count	counters indexed by cpu, all values are added
+**
+**	@returns number of cpu columns.
+*/
+static int IrqParse(const char *buf, uint64_t * count)
+{
+    const char *s;
+    char *e;
+    int n;
+    int cpu;
+
+    // header line "CPU0 CPU1 ...", offline cpus are missing
+    n = 0;
+    for (s = buf; *s && *s != '\n'; s = e) {
+	s += strspn(s, " ");
+	if (strncmp(s, "CPU", 3)) {
+	    break;
+	}
+	cpu = strtol(s + 3, &e, 10);
+	if (n < Irq.Cpus && cpu < Irq.Cpus) {
+	    Irq.Column[n++] = cpu;
+	}
+    }
+    if (!n) {
+	return 0;
+    }
+    // each line is "name: column values... description\n"
+    while ((s = strchr(s, '\n')) && *++s) {
+	s += strspn(s, " ");
+	if (!strncmp(s, "ERR:", 4) || !strncmp(s, "MIS:", 4)) {
+	    continue;			// global counters
+	}
+	if ((e = strchr(s, ':')) && e < strchrnul(s, '\n')) {
+	    s = IrqParseColumns(e + 1, n, count);
+	}
+    }
+    return n;
+}
+
+/**
+**	Read interrupts and softirqs.
+**
+**	Bars show the hottest cpus, their numbers are the labels.  The parse
+**	cost is measured, parsing is skipped for ticks, if it exceeds 1% of
+**	the refresh rate.
+**
+**	@returns -1 if failures.
+*/
+int GetIrqStat(void)
+{
+    uint64_t start;
+    uint64_t dt;
+    uint64_t rate;
+    int cost;
+    int budget;
+    int i;
+    int j;
+    int n;
+
+    if (Irq.Skip) {
+	--Irq.Skip;
+	return 0;
+    }
+    start = GetUsTime();
+
+    memset(Irq.Count, 0, Irq.Cpus * sizeof(*Irq.Count));
+    if (ReadFdGrow(Irq.Fd[0], &Irq.Buffer, &Irq.BufferSize) <= 0) {
+	return -1;
+    }
+    Irq.Online = IrqParse(Irq.Buffer, Irq.Count);
+    if (Irq.Fd[1] >= 0
+	&& ReadFdGrow(Irq.Fd[1], &Irq.Buffer, &Irq.BufferSize) > 0) {
+	IrqParse(Irq.Buffer, Irq.Count);
+    }
+
+    //
+    //	rates and the hottest cpus (insertion into the short top list)
+    //
+    n = Irq.Online < MAX_CPUS ? Irq.Online : MAX_CPUS;
+    dt = start - Irq.Time;
+    for (i = 0; i < n; ++i) {
+	Irq.Top[i] = -1;
+    }
+    for (i = 0; i < Irq.Cpus; ++i) {
+	rate = 0;
+	if (Irq.Time && dt) {
+	    rate = (CounterDelta(Irq.Count[i], Irq.OldCount[i]) * 1000000)
+		/ dt;
+	}
+	Irq.Rate[i] = rate;
+	Irq.OldCount[i] = Irq.Count[i];
+	for (j = n; j > 0; --j) {
+	    if (Irq.Top[j - 1] >= 0 && Irq.Rate[Irq.Top[j - 1]] >= rate) {
+		break;
+	    }
+	    if (j < n) {
+		Irq.Top[j] = Irq.Top[j - 1];
+	    }
+	}
+	if (j < n) {
+	    Irq.Top[j] = i;
+	}
+    }
+    Irq.Time = start;
+
+    Cpus = n ? n : 1;
+    for (i = 0; i < n; ++i) {
+	rate = Irq.Top[i] >= 0 ? Irq.Rate[Irq.Top[i]] : 0;
+	if (i) {			// same scale as the hottest cpu
+	    CpuInfo[i].Load = (100 * rate) / Irq.Peak;
+	} else {
+	    CpuInfo[i].Load = AutoScale(&Irq.Peak, rate, 100);
+	}
+	CpuInfo[i].History = CpuInfo[i].Load;
+    }
+
+    //
+    //	bound the cost: avg. parse time <= 1% of the refresh rate, -r 0
+    //	counts as 1 ms
+    //
+    cost = GetUsTime() - start;
+    Irq.Cost += cost - Irq.Cost / 16;
+    budget = Rate > 1 ? Rate * 10 : 10;
+    if (Irq.Cost / 16 > budget) {
+	Irq.Skip = Irq.Cost / 16 / budget;
+    }
+
+    return n;
+}
+
+/**
+**	Draw the numbers of the hottest cpus into the history graph.
+**
+**	@param force	draw, also if the cpus are unchanged
+*/
+void DrawIrqLabels(int force)
+{
+    char buf[16];
+    int c;
+    int y;
+    int o;
+    int r;
+
+    y = 6;
+    o = 40 / Cpus;
+    r = 40 % Cpus;
+    for (c = 0; c < Cpus; ++c) {
+	if (!r--) {			// no remainder reduce
+	    --o;
+	}
+	if (force || Irq.Top[c] != Irq.OldTop[c]) {
+	    Irq.OldTop[c] = Irq.Top[c];
+	    if (Irq.Top[c] >= 0) {
+		snprintf(buf, sizeof(buf), "%d", Irq.Top[c]);
+		DrawText(6, y, buf);
+	    }
+	}
+	y += o + 1;
+    }
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/schedstat
+
+    ///
+    /// run queue latency from /proc/schedstat
+    /// @see /usr/src/linux/Documentation/scheduler/sched-stats.rst
+    ///
+static struct schedstat_info
+{
+    int Fd;				///< open /proc/schedstat
+    char *Buffer;			///< read buffer
+    int BufferSize;			///< size of the read buffer
+    uint64_t Delay[MAX_CPUS];		///< time spent waiting on the runqueue
+    uint64_t Slices[MAX_CPUS];		///< timeslices run
+} Schedstat;
+
+/**
+**	Open the schedstat file.
+**
+**	@returns -1 if failures.
+*/
+int SchedstatOpen(void)
+{
+    if ((Schedstat.Fd = open(ProcPath("/proc/schedstat"),
+		O_RDONLY | O_CLOEXEC)) < 0) {
+	fprintf(stderr, "Can't open /proc/schedstat: %s\n", strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+/**
+**	Read schedstat.
+**
+**	Bars show the average wait on the runqueue per timeslice, 1ms is full
+**	scale.  Uses the same cpu selection as /proc/stat (-a, -c, -j).
+**
+**	@returns -1 if failures.
+*/
+int GetSchedstat(void)
+{
+    uint64_t delay[MAX_CPUS];
+    uint64_t slices[MAX_CPUS];
+    uint64_t v[9];
+    const char *s;
+    char *e;
+    int cpu;
+    int rows;
+    int i;
+
+    if (ReadFdGrow(Schedstat.Fd, &Schedstat.Buffer,
+	    &Schedstat.BufferSize) <= 0) {
+	return -1;
+    }
+    memset(delay, 0, sizeof(delay));
+    memset(slices, 0, sizeof(slices));
+    rows = 0;
+    for (s = Schedstat.Buffer; (s = strstr(s, "\ncpu"));) {
+	// each line is "cpuN values...", domain lines follow
+	cpu = strtol(s + 4, &e, 10);
+	for (i = 0; i < 9; ++i) {
+	    v[i] = strtoull(e, &e, 10);
+	}
+	s = e;
+	if ((cpu = CpuRow(cpu)) < 0) {
+	    continue;
+	}
+	// 8: run_delay (ns) 9: pcount
+	delay[cpu] += v[7];
+	slices[cpu] += v[8];
+	if (cpu >= rows) {
+	    rows = cpu + 1;
+	}
+    }
+
+    for (i = 0; i < rows; ++i) {
+	uint64_t wait;
+
+	wait = 0;
+	if (slices[i] > Schedstat.Slices[i]) {
+	    wait = (delay[i] - Schedstat.Delay[i])
+		/ (slices[i] - Schedstat.Slices[i]);
+	}
+	CpuInfo[i].Load = wait >= 1000000 ? 100 : wait / 10000;
+	CpuInfo[i].History = CpuInfo[i].Load;
+	Schedstat.Delay[i] = delay[i];
+	Schedstat.Slices[i] = slices[i];
+    }
+    Cpus = rows ? rows : 1;
+
+    return rows;
+}
+
+// ------------------------------------------------------------------------- //
+// perf_event_open software counters
+
+    ///
+    /// software perf events per cpu
+    ///
+enum perf_event
+{
+    PERF_SWITCHES,			///< context switches
+    PERF_MIGRATIONS,			///< cpu migrations
+    PERF_FAULTS,			///< page faults
+    PERF_EVENTS				///< number of events
+};
+
+    ///
+    /// counter group of a cpu
+    ///
+struct perf_group
+{
+    int Fd;				///< group leader, read all counters
+    int Row;				///< bar of the cpu
+    uint64_t Value[PERF_EVENTS];	///< last read counter values
+};
+
+    ///
+    /// perf event counters
+    ///
+static struct perf_info
+{
+    struct perf_group *Group;		///< counter groups of the cpus
+    int Groups;				///< number of counter groups
+    uint64_t Time;			///< time of last read in us
+    uint64_t Rate[PERF_EVENTS];		///< events/s of all monitored cpus
+    uint64_t Bar[MAX_CPUS];		///< bar event/s of each bar
+} Perf;
+
+/**
+**	Open software perf event counters of all monitored cpus.
+**
+**	Each cpu gets a group of context switch, migration and page fault
+**	counters, read with a single read per cpu.  Software events need no
+**	PMU, but counting a whole cpu needs perf_event_paranoid <= 0 or
+**	CAP_PERFMON.
+**
+**	@returns -1 if failures.
+*/
+int PerfOpen(void)
+{
+    static const uint64_t config[PERF_EVENTS] = {
+	PERF_COUNT_SW_CONTEXT_SWITCHES, PERF_COUNT_SW_CPU_MIGRATIONS,
+	PERF_COUNT_SW_PAGE_FAULTS
+    };
+    struct perf_event_attr attr;
+    int fds[PERF_EVENTS];
+    long cpus;
+    int cpu;
+    int row;
+    int i;
+
+    if ((cpus = sysconf(_SC_NPROCESSORS_CONF)) < 1) {
+	cpus = 1;
+    }
+    if (!(Perf.Group = calloc(cpus, sizeof(*Perf.Group)))) {
+	return -1;
+    }
+    for (cpu = 0; cpu < cpus; ++cpu) {
+	if ((row = CpuRow(cpu)) < 0) {
+	    continue;
+	}
+	for (i = 0; i < PERF_EVENTS; ++i) {
+	    memset(&attr, 0, sizeof(attr));
+	    attr.type = PERF_TYPE_SOFTWARE;
+	    attr.size = sizeof(attr);
+	    attr.config = config[i];
+	    attr.read_format = PERF_FORMAT_GROUP;
+
+	    // first counter is the group leader
+	    fds[i] = syscall(SYS_perf_event_open, &attr, -1, cpu,
+		i ? fds[0] : -1, PERF_FLAG_FD_CLOEXEC);
+	    if (fds[i] < 0) {
+		if (errno == ENODEV) {	// cpu is offline
+		    while (--i >= 0) {	// close the partial group
+			close(fds[i]);
+		    }
+		    break;
+		}
+		fprintf(stderr, "Can't open perf event of cpu%d: %s\n", cpu,
+		    strerror(errno));
+		if (errno == EACCES || errno == EPERM) {
+		    fprintf(stderr, "Need perf_event_paranoid <= 0 or "
+			"CAP_PERFMON\n");
+		}
+		return -1;
+	    }
+	}
+	if (i == PERF_EVENTS) {
+	    Perf.Group[Perf.Groups].Fd = fds[0];
+	    Perf.Group[Perf.Groups].Row = row;
+	    ++Perf.Groups;
+	}
+    }
+    if (!Perf.Groups) {
+	fprintf(stderr, "No cpu for perf events\n");
+	return -1;
+    }
+    return 0;
+}
+
+/**
+**	Read perf event counters.
+**
+**	One read per cpu gets all counters of its group.
+**
+**	@returns number of counter groups.
+*/
+int PerfRead(void)
+{
+    uint64_t buf[1 + PERF_EVENTS];
+    uint64_t now;
+    uint64_t delta;
+    struct perf_group *group;
+    int i;
+
+    now = GetUsTime();
+    delta = Perf.Time ? now - Perf.Time : 0;
+    Perf.Time = now;
+
+    memset(Perf.Bar, 0, sizeof(Perf.Bar));
+    memset(Perf.Rate, 0, sizeof(Perf.Rate));
+    for (group = Perf.Group; group < Perf.Group + Perf.Groups; ++group) {
+	// group read format: nr, values...
+	if (read(group->Fd, buf, sizeof(buf)) != sizeof(buf)) {
+	    continue;
+	}
+	for (i = 0; i < PERF_EVENTS; ++i) {
+	    if (delta) {
+		uint64_t r;
+
+		r = ((buf[1 + i] - group->Value[i]) * 1000000) / delta;
+		Perf.Rate[i] += r;
+		if (i == PerfBar) {
+		    Perf.Bar[group->Row] += r;
+		}
+	    }
+	    group->Value[i] = buf[1 + i];
+	}
+    }
+
+    return Perf.Groups;
+}
+
+/**
+**	Read perf event counters and cpu utilization.
+**
+**	Bars show the selected event (context switches, migrations or page
+**	faults) per second of each cpu, logarithmic 1M/s is full scale.
+**	History shows the cpu utilization of /proc/stat.
+**
+**	@returns -1 if failures.
+*/
+int GetPerfStat(void)
+{
+    int i;
+    int n;
+
+    GetStat();				// load for the history
+    PerfRead();
+
+    for (i = 0; i < Cpus; ++i) {
+	// 5% per power of 2, 20 bits are max
+	n = Perf.Bar[i] ? (64 - __builtin_clzll(Perf.Bar[i])) * 5 : 0;
+	CpuInfo[i].Load = n > 100 ? 100 : n;
+    }
+
+    return Perf.Groups;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/<pid>/task/<tid>/stat
+
+    ///
+    /// thread of the monitored process
+    ///
+struct thread_info
+{
+    int Tid;				///< thread id
+    int Fd;				///< open /proc/<pid>/task/<tid>/stat
+    uint64_t Time;			///< utime + stime in clock ticks
+};
+
+    ///
+    /// monitored process
+    ///
+static struct process_info
+{
+    int Pid;				///< process id
+    int Fd;				///< open /proc/<pid>/stat
+    int Threads;			///< number of threads in table
+    int MaxThreads;			///< size of thread table
+    struct thread_info *Thread;		///< threads, sorted by tid
+    int Rescan;				///< ticks until next task rescan
+    long Hz;				///< clock ticks per second
+    uint64_t Time;			///< time of last sample in us
+    int Rows;				///< number of bars
+    int Width[MAX_CPUS];		///< number of cpus of each bar
+} Process;
+
+/**
+**	Get fields of a stat line ("pid (comm) state ...").
+**
+**	@param buf	stat contents
+**	@param n	number of fields wanted, starting with field 3 (state)
+**	@param[out] v	the field values, v[0] field 4 (ppid)
+**
+**	@returns -1 if failures.
+*/
+static int PidStatFields(const char *buf, int n, uint64_t * v)
+{
+    const char *s;
+    char *e;
+    int i;
+
+    if (!(s = strrchr(buf, ')'))) {	// comm can contain anything
+	return -1;
+    }
+    s += 3;				// skip ") S"
+    for (i = 0; i < n; ++i) {
+	v[i] = strtoull(s, &e, 10);
+	s = e;
+    }
+    return 0;
+}
+
+/**
+**	Compare thread ids for sort and search.
+*/
+static int ThreadCmp(const void *a, const void *b)
+{
+    return ((const struct thread_info *)a)->Tid -
+	((const struct thread_info *)b)->Tid;
+}
+
+/**
+**	Add the new threads of the monitored process.
+**
+**	Only threads missing in the table are opened, threads which are gone
+**	are removed, when their stat can't be read anymore.
+*/
+static void ProcessScanTasks(void)
+{
+    char path[64];
+    struct dirent *dirent;
+    struct thread_info key;
+    struct thread_info *thread;
+    DIR *dir;
+    int n;
+
+    snprintf(path, sizeof(path), "/proc/%d/task", Process.Pid);
+    if (!(dir = opendir(path))) {
+	return;
+    }
+    n = Process.Threads;
+    while ((dirent = readdir(dir))) {
+	if (!(key.Tid = atoi(dirent->d_name))) {
+	    continue;
+	}
+	if (n && bsearch(&key, Process.Thread, n, sizeof(key), ThreadCmp)) {
+	    continue;
+	}
+	if (Process.Threads == Process.MaxThreads) {
+	    thread = realloc(Process.Thread,
+		(Process.MaxThreads * 2 + 16) * sizeof(*thread));
+	    if (!thread) {
+		break;
+	    }
+	    Process.Thread = thread;
+	    Process.MaxThreads = Process.MaxThreads * 2 + 16;
+	}
+	snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", Process.Pid,
+	    key.Tid);
+	thread = Process.Thread + Process.Threads;
+	if ((thread->Fd = open(path, O_RDONLY | O_CLOEXEC)) >= 0) {
+	    thread->Tid = key.Tid;
+	    thread->Time = UINT64_MAX;	// no delta for first sample
+	    ++Process.Threads;
+	}
+    }
+    closedir(dir);
+    if (n != Process.Threads) {
+	qsort(Process.Thread, Process.Threads, sizeof(*Process.Thread),
+	    ThreadCmp);
+    }
+}
+
+/**
+**	Open the process to monitor.
+**
+**	@param pid	process id
+**
+**	@returns -1 if failures.
+*/
+int ProcessOpen(int pid)
+{
+    char path[64];
+    const char *s;
+    char *e;
+    int cpu;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    if ((Process.Fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+	fprintf(stderr, "Can't open %s: %s\n", path, strerror(errno));
+	return -1;
+    }
+    Process.Pid = pid;
+    Process.Hz = sysconf(_SC_CLK_TCK);
+    ProcessScanTasks();
+
+    // cpus of each bar, from the online cpus in /proc/stat (may have holes)
+    Process.Rows = 1;
+    if (ReadStat() > 0) {
+	// skip the first total cpu line, each line is "cpuN values\n"
+	for (s = StatBuffer; (s = strstr(s, "\ncpu"));) {
+	    cpu = strtol(s + 4, &e, 10);
+	    s = e;
+	    if ((cpu = CpuRow(cpu)) >= 0) {
+		++Process.Width[cpu];
+		if (cpu >= Process.Rows) {
+		    Process.Rows = cpu + 1;
+		}
+	    }
+	}
+    }
+    return 0;
+}
+
+/**
+**	The monitored process has exited, close its files and clear the bars.
+*/
+static void ProcessExited(void)
+{
+    int i;
+
+    fprintf(stderr, "Process %d has exited\n", Process.Pid);
+    for (i = 0; i < Process.Threads; ++i) {
+	close(Process.Thread[i].Fd);
+    }
+    Process.Threads = 0;
+    close(Process.Fd);
+    Process.Fd = -1;
+    for (i = 0; i < Cpus; ++i) {
+	CpuInfo[i].Load = 0;
+	CpuInfo[i].History = 0;
+    }
+}
+
+/**
+**	Read the thread stats of the monitored process.
+**
+**	The cpu time of each thread is added to the cpu, it last run on.
+**	The thread table is only rescanned, if num_threads changes or every
+**	40th tick (a thread exited and a new started).  After the process
+**	has exited, the bars stay empty.
+**
+**	@returns number of bars.
+*/
+int GetProcessStat(void)
+{
+    char buf[1024];
+    uint64_t v[37];
+    uint64_t used[MAX_CPUS];
+    uint64_t now;
+    uint64_t time;
+    uint64_t total;
+    struct thread_info *thread;
+    int cpu;
+    int i;
+    int j;
+
+    if (Process.Fd < 0) {		// process has exited
+	return Cpus;
+    }
+    // num_threads of the process is field 20
+    if (ReadFd(Process.Fd, buf, sizeof(buf)) <= 0
+	|| PidStatFields(buf, 17, v) < 0) {
+	ProcessExited();
+	return Cpus;
+    }
+    if ((int)v[16] != Process.Threads || --Process.Rescan < 0) {
+	ProcessScanTasks();
+	Process.Rescan = 40;
+    }
+    now = GetUsTime();
+
+    memset(used, 0, sizeof(used));
+    for (i = j = 0; i < Process.Threads; ++i) {
+	thread = Process.Thread + i;
+	// utime field 14, stime field 15, processor field 39
+	if (ReadFd(thread->Fd, buf, sizeof(buf)) <= 0
+	    || PidStatFields(buf, 37, v) < 0) {
+	    close(thread->Fd);		// thread is gone
+	    continue;
+	}
+	time = v[10] + v[11];
+	cpu = CpuRow(v[35]);
+	if (cpu >= 0 && time > thread->Time) {
+	    used[cpu] += time - thread->Time;
+	}
+	thread->Time = time;
+	Process.Thread[j++] = *thread;
+    }
+    Process.Threads = j;
+
+    // full scale: all cpus of a bar busy
+    total = (now - Process.Time) * Process.Hz;
+    for (i = 0; i < Process.Rows; ++i) {
+	CpuInfo[i].Load = 0;
+	if (Process.Time && total && Process.Width[i]) {
+	    CpuInfo[i].Load =
+		(100 * 1000000 * used[i]) / (total * Process.Width[i]);
+	    if (CpuInfo[i].Load > 100) {
+		CpuInfo[i].Load = 100;
+	    }
+	}
+	CpuInfo[i].History = CpuInfo[i].Load;
+    }
+    Process.Time = now;
+    Cpus = Process.Rows;
+
+    return Cpus;
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/<pid>/stat top cpu users
+
+#define TOP_N 4				///< number of top processes shown
+
+    ///
+    /// process seen by the top scan
+    ///
+struct top_entry
+{
+    int Pid;				///< process id
+    int Usage;				///< cpu usage in procent of one cpu
+    uint64_t Time;			///< utime + stime in clock ticks
+    uint64_t Stamp;			///< time of sample in us
+    char Comm[16];			///< short name of process
+};
+
+    ///
+    /// table of processes, sorted by pid
+    ///
+struct top_table
+{
+    struct top_entry *Entry;		///< processes
+    int Count;				///< number of processes in table
+    int Size;				///< size of the table
+};
+
+    ///
+    /// top cpu users, scanned incremental over multiple ticks
+    ///
+static struct top_info
+{
+    DIR *Dir;				///< /proc while a scan runs
+    struct top_table Old;		///< processes of the last scan
+    struct top_table New;		///< processes of the running scan
+    int OldPos;				///< merge position in old table
+    struct top_entry Top[TOP_N];	///< top cpu users of last scan
+    int TopN;				///< number of top cpu users
+    long Hz;				///< clock ticks per second
+} Top;
+
+static char TopMode;			///< show top cpu users
+
+/**
+**	Scan a part of /proc.
+**
+**	/proc lists the processes sorted by pid, the old table is walked
+**	parallel to find the last sample of the process.  The scan stops,
+**	after 5% of the refresh rate and continues with the next call.
+**
+**	@returns true if a scan is complete.
+*/
+int TopScan(void)
+{
+    char path[64];
+    char buf[1024];
+    uint64_t start;
+    uint64_t v[12];
+    struct dirent *dirent;
+    struct top_entry *entry;
+    const struct top_entry *old;
+    const char *s;
+    const char *e;
+    int pid;
+    int fd;
+    int n;
+    int i;
+    int j;
+
+    start = GetUsTime();
+    if (!Top.Dir) {
+	if (!(Top.Dir = opendir("/proc"))) {
+	    return 0;
+	}
+	Top.New.Count = 0;
+	Top.OldPos = 0;
+	Top.Hz = sysconf(_SC_CLK_TCK);
+    }
+    while ((dirent = readdir(Top.Dir))) {
+	if (!(pid = atoi(dirent->d_name))) {
+	    continue;
+	}
+	snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+	    continue;
+	}
+	n = ReadFd(fd, buf, sizeof(buf));
+	close(fd);
+	// utime field 14, stime field 15
+	if (n <= 0 || !(s = strchr(buf, '('))
+	    || PidStatFields(buf, 12, v) < 0) {
+	    continue;
+	}
+	if (Top.New.Count == Top.New.Size) {
+	    entry = realloc(Top.New.Entry,
+		(Top.New.Size * 2 + 256) * sizeof(*entry));
+	    if (!entry) {
+		break;
+	    }
+	    Top.New.Entry = entry;
+	    Top.New.Size = Top.New.Size * 2 + 256;
+	}
+	entry = Top.New.Entry + Top.New.Count++;
+	entry->Pid = pid;
+	entry->Time = v[10] + v[11];
+	entry->Stamp = GetUsTime();
+	e = strrchr(s, ')');
+	n = e - s - 1 < (int)sizeof(entry->Comm) ? e - s - 1 :
+	    (int)sizeof(entry->Comm) - 1;
+	memcpy(entry->Comm, s + 1, n);
+	entry->Comm[n] = '\0';
+
+	// find last sample in old table
+	while (Top.OldPos < Top.Old.Count
+	    && Top.Old.Entry[Top.OldPos].Pid < pid) {
+	    ++Top.OldPos;
+	}
+	entry->Usage = 0;
+	if (Top.OldPos < Top.Old.Count
+	    && (old = Top.Old.Entry + Top.OldPos)->Pid == pid
+	    && entry->Time >= old->Time && entry->Stamp > old->Stamp) {
+	    entry->Usage = (100 * 1000000 * (entry->Time - old->Time))
+		/ ((entry->Stamp - old->Stamp) * Top.Hz);
+	}
+
+	if (entry->Stamp - start > (uint64_t) Rate * 50) {
+	    return 0;			// continue with next tick
+	}
+    }
+    closedir(Top.Dir);
+    Top.Dir = NULL;
+
+    //
+    //	new table becomes old, select the top cpu users
+    //
+    {
+	struct top_table table;
+
+	table = Top.Old;
+	Top.Old = Top.New;
+	Top.New = table;
+    }
+    Top.TopN = 0;
+    for (i = 0; i < Top.Old.Count; ++i) {
+	entry = Top.Old.Entry + i;
+	if (!entry->Usage) {
+	    continue;
+	}
+	for (j = Top.TopN; j > 0 && Top.Top[j - 1].Usage < entry->Usage; --j) {
+	    if (j < TOP_N) {
+		Top.Top[j] = Top.Top[j - 1];
+	    }
+	}
+	if (j < TOP_N) {
+	    Top.Top[j] = *entry;
+	    if (Top.TopN < TOP_N) {
+		++Top.TopN;
+	    }
+	}
+    }
+    return 1;
+}
+
+/**
+**	Draw top cpu users into the history graph area.
+*/
+void DrawTop(void)
+{
+    char buf[32];
+    int i;
+    int n;
+
+    if (!TopScan()) {
+	return;
+    }
+    CopyArea(Image, Pixmap, 6, 6, 6, 6, 48, 39);
+    // name and usage must fit into the 48 pixel of the graph
+    n = (48 * Scale) / (TextWidth ? TextWidth : 5) - 4;
+    for (i = 0; i < Top.TopN; ++i) {
+	snprintf(buf, sizeof(buf), "%-*.*s%3d%%", n, n, Top.Top[i].Comm,
+	    Top.Top[i].Usage > 999 ? 999 : Top.Top[i].Usage);
+	DrawText(6, 6 + i * 10, buf);
+    }
+}
+
+/**
+**	Toggle between the history graph and the top cpu users.
+*/
+void TopToggle(void)
+{
+    int c;
+
+    TopMode ^= 1;
+    CopyArea(Image, Pixmap, 6, 6, 6, 6, 48, 39);
+    if (TopMode) {
+	DrawText(6, 6, "...");
+	// start with a fresh scan, the first scan has no usage
+	Top.Old.Count = 0;
+	TopScan();
+    } else {
+	if (Top.Dir) {
+	    closedir(Top.Dir);
+	    Top.Dir = NULL;
+	}
+	for (c = 0; c < MAX_CPUS; ++c) {	// graph restarts
+	    CpuInfo[c].AvgLoad = 0;
+	    CpuInfo[c].OldAvgLoadSize = -1;
+	}
+    }
+    LayoutCompile();
+}
+
+// ------------------------------------------------------------------------- //
+// /proc/stat summary of all cpus
+
+    ///
+    /// load distribution of all cpus
+    ///
+static struct summary_info
+{
+    struct cpu_time
+    {
+	uint64_t Idle;			///< time cpu idle
+	uint64_t Used;			///< time cpu used
+    } *Cpu;				///< times of all cpus
+    int Cpus;				///< size of cpu table
+} Summary;
+
+/**
+**	Read stat and summarize the load of all cpus.
+**
+**	The bars show the 50th, 90th, 99th percentile and the maximum of the
+**	cpu loads, the history shows the imbalance (max - mean) / max.  A
+**	counting histogram of the loads avoids sorting, the cost is O(cpus).
+**
+**	@returns -1 if failures.
+*/
+int GetSummaryStat(void)
+{
+    static const int percentile[MAX_CPUS] = { 50, 90, 99, 100 };
+    unsigned histogram[101];
+    uint64_t user;
+    uint64_t nice;
+    uint64_t system;
+    uint64_t idle;
+    uint64_t used;
+    uint64_t total;
+    uint64_t sum;
+    struct cpu_time *cpu;
+    const char *s;
+    char *e;
+    int load;
+    int max;
+    int n;
+    int c;
+    int i;
+
+    if (ReadStat() <= 0) {
+	return -1;
+    }
+    memset(histogram, 0, sizeof(histogram));
+    sum = 0;
+    max = 0;
+    n = 0;
+    // skip the first total cpu line, each line is "cpuN values\n"
+    for (s = StatBuffer; (s = strchr(s, '\n')) && !strncmp(++s, "cpu", 3);) {
+	c = strtol(s + 3, &e, 10);
+	user = strtoull(e, &e, 10);
+	nice = strtoull(e, &e, 10);
+	system = strtoull(e, &e, 10);
+	idle = strtoull(e, &e, 10);
+	if (c >= Summary.Cpus) {
+	    if (!(cpu = realloc(Summary.Cpu, (c + 1) * sizeof(*cpu)))) {
+		break;
+	    }
+	    memset(cpu + Summary.Cpus, 0, (c + 1 - Summary.Cpus)
+		* sizeof(*cpu));
+	    Summary.Cpu = cpu;
+	    Summary.Cpus = c + 1;
+	}
+	cpu = Summary.Cpu + c;
+
+	used = user + nice + system;
+	total = used + idle - cpu->Used - cpu->Idle;
+	load = 0;
+	if (total && used > cpu->Used) {
+	    load = (100 * (used - cpu->Used)) / total;
+	    if (load > 100) {
+		load = 100;
+	    }
+	}
+	cpu->Idle = idle;
+	cpu->Used = used;
+
+	++histogram[load];
+	sum += load;
+	if (load > max) {
+	    max = load;
+	}
+	++n;
+    }
+    if (!n) {
+	return -1;
+    }
+    //
+    //	percentiles from the cumulative histogram
+    //
+    for (i = c = 0, load = 0; i < MAX_CPUS; ++i) {
+	for (; load <= 100; ++load) {
+	    if ((c + histogram[load]) * 100 >= (unsigned)(percentile[i] * n)) {
+		break;
+	    }
+	    c += histogram[load];
+	}
+	CpuInfo[i].Load = load > 100 ? 100 : load;
+	CpuInfo[i].History = 0;
+    }
+    CpuInfo[0].History = max ? (100 * max - (100 * sum) / n) / max : 0;
+
+    Cpus = MAX_CPUS;
+    Graphs = 1;
+
+    return n;
+}
+
+// ------------------------------------------------------------------------- //
+// scheduling
+
+/**
+**	Print a cpu set as cpu list (" 0-3,8").
+**
+**	@param set	cpus to print
+*/
+static void PrintCpuSet(const cpu_set_t * set)
+{
+    const char *sep;
+    int first;
+    int cpu;
+
+    sep = " ";
+    for (cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+	if (!CPU_ISSET(cpu, set)) {
+	    continue;
+	}
+	first = cpu;
+	while (cpu + 1 < CPU_SETSIZE && CPU_ISSET(cpu + 1, set)) {
+	    ++cpu;
+	}
+	if (cpu == first) {
+	    printf("%s%d", sep, first);
+	} else {
+	    printf("%s%d-%d", sep, first, cpu);
+	}
+	sep = ",";
+    }
+}
+
+/**
+**	Restrict the dockapp to the housekeeping cpus and set its priority.
+**
+**	Must be called before any thread is created, the settings are
+**	inherited.  On isolated cores any wakeup of the monitor is jitter on
+**	the monitored cores, report if we can run on them.
+**
+**	@returns -1 if failures.
+*/
+int SchedulingSetup(void)
+{
+    cpu_set_t set;
+    cpu_set_t monitored;
+    char buf[256];
+    int fd;
+    int cpu;
+    int n;
+
+    if (Housekeeping) {
+	CPU_ZERO(&set);
+	if (!CountCpuList(Housekeeping, &set)) {
+	    fprintf(stderr, "Bad cpu list '%s'\n", Housekeeping);
+	    return -1;
+	}
+	if (sched_setaffinity(0, sizeof(set), &set)) {
+	    fprintf(stderr, "Can't set cpu affinity %s: %s\n", Housekeeping,
+		strerror(errno));
+	    return -1;
+	}
+    }
+    if (IdlePolicy) {
+	struct sched_param param;
+
+	param.sched_priority = 0;
+	if (sched_setscheduler(0, SCHED_IDLE, &param)) {
+	    fprintf(stderr, "Can't set SCHED_IDLE: %s\n", strerror(errno));
+	    return -1;
+	}
+    }
+    if (Niceness && setpriority(PRIO_PROCESS, 0, Niceness)) {
+	fprintf(stderr, "Can't set nice %d: %s\n", Niceness,
+	    strerror(errno));
+	return -1;
+    }
+    if (TimerSlack && prctl(PR_SET_TIMERSLACK, TimerSlack * 1000UL)) {
+	fprintf(stderr, "Can't set timer slack: %s\n", strerror(errno));
+	return -1;
+    }
+
+    if (!Housekeeping) {
+	return 0;
+    }
+    //
+    //	verify and report the cpus we run on and the monitored cpus
+    //
+    CPU_ZERO(&monitored);
+    n = 0;
+    if ((fd = open(ProcPath("/sys/devices/system/cpu/online"),
+		O_RDONLY | O_CLOEXEC)) >= 0) {
+	if (ReadFd(fd, buf, sizeof(buf)) > 0) {
+	    n = CountCpuList(buf, &monitored);
+	}
+	close(fd);
+    }
+    if (!n) {				// no sysfs, all configured cpus
+	for (cpu = sysconf(_SC_NPROCESSORS_CONF); --cpu >= 0;) {
+	    CPU_SET(cpu, &monitored);
+	}
+    }
+    // -u and -i monitor all cpus, else only those shown by the bars
+    if (!Summarize && !IrqMode) {
+	for (cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+	    if (CPU_ISSET(cpu, &monitored) && CpuRow(cpu) < 0) {
+		CPU_CLR(cpu, &monitored);
+	    }
+	}
+    }
+    if (sched_getaffinity(0, sizeof(set), &set)) {
+	fprintf(stderr, "Can't get cpu affinity: %s\n", strerror(errno));
+	return -1;
+    }
+    printf("wmcpumon: runs on cpus");
+    PrintCpuSet(&set);
+    printf(", monitors cpus");
+    PrintCpuSet(&monitored);
+    printf("\n");
+
+    CPU_AND(&monitored, &monitored, &set);
+    if ((n = CPU_COUNT(&monitored))) {
+	fprintf(stderr, "wmcpumon: %d monitored cpus are in the cpu list %s\n",
+	    n, Housekeeping);
+    }
+    if (!CPU_ISSET(cpu = sched_getcpu(), &set)) {
+	fprintf(stderr, "wmcpumon: runs on cpu %d outside of %s\n", cpu,
+	    Housekeeping);
+    }
+
+    return 0;
+}
+
+// ------------------------------------------------------------------------- //
+
+static int (*CpuSample)(void) = GetStat;	///< read cpu utilization
+static int (*MemSample)(void) = GetMeminfo;	///< read memory usage
+
+// ------------------------------------------------------------------------- //
+// sprite atlas
+
+#define ATLAS_GRAPH_X	(41 * 3)	///< x of the graph columns in atlas
+
+    ///
+    /// row of bars or graphs in the atlas
+    ///
+struct atlas_row
+{
+    uint8_t Y;				///< y of row in the dockapp
+    uint8_t Height;			///< height of row
+    uint8_t Size[101];			///< load to empty size of row
+};
+
+    ///
+    /// pre-rendered bar and graph column states
+    ///
+    /// Bar states of a row are side by side at x = empty size * 3, graph
+    /// columns at x = ATLAS_GRAPH_X + empty size.  The bars are in the
+    /// upper half, the graphs in the lower half, with the dockapp y - 6.
+    ///
+static struct atlas_info
+{
+    int Bars;				///< number of bar rows
+    int Graphs;				///< number of graph rows
+    struct atlas_row Bar[MAX_CPUS];	///< bar rows
+    struct atlas_row Graph[MAX_CPUS];	///< graph rows
+} Atlas;
+
+/**
+**	Split the bar or graph area into rows and build the size table.
+**
+**	@param row	rows to fill
+**	@param rows	number of rows
+*/
+static void AtlasRows(struct atlas_row *row, int rows)
+{
+    int c;
+    int i;
+    int n;
+    int y;
+    int o;
+    int r;
+
+    y = 6;
+    o = 40 / rows;
+    r = 40 % rows;
+    for (c = 0; c < rows; ++c) {
+	if (!r--) {			// no remainder reduce
+	    --o;
+	}
+	row[c].Y = y;
+	row[c].Height = o;
+	for (i = 0; i <= 100; ++i) {
+	    n = Logscale ? Log10[i] : i;
+	    row[c].Size[i] = o - ((o * n) / 100);
+	}
+	y += o + 1;
+    }
+}
+
+/**
+**	Build the atlas of all bar states for rows bars.
+**
+**	@param rows	number of bar rows
+*/
+static void AtlasBuildBars(int rows)
+{
+    const struct atlas_row *row;
+    int c;
+    int n;
+
+    AtlasRows(Atlas.Bar, rows);
+    for (c = 0; c < rows; ++c) {
+	row = Atlas.Bar + c;
+	for (n = 0; n <= row->Height; ++n) {
+	    if (n) {
+		CopyArea(Image, AtlasPixmap, 56, row->Y, n * 3, row->Y - 6, 3,
+		    n);
+	    }
+	    if (n != row->Height) {
+		CopyArea(Image, AtlasPixmap, 65 - 3 + rows * 3, n, n * 3,
+		    row->Y - 6 + n, 3, row->Height - n);
+	    }
+	}
+	CpuInfo[c].OldLoadSize = -1;
+    }
+    Atlas.Bars = rows;
+}
+
+/**
+**	Build the atlas of all graph column states for rows graphs.
+**
+**	@param rows	number of graph rows
+*/
+static void AtlasBuildGraphs(int rows)
+{
+    const struct atlas_row *row;
+    int c;
+    int n;
+
+    AtlasRows(Atlas.Graph, rows);
+    for (c = 0; c < rows; ++c) {
+	row = Atlas.Graph + c;
+	for (n = 0; n <= row->Height; ++n) {
+	    if (n) {
+		CopyArea(Image, AtlasPixmap, 55, row->Y, ATLAS_GRAPH_X + n,
+		    40 + row->Y - 6, 1, n);
+	    }
+	    if (n != row->Height) {
+		CopyArea(Image, AtlasPixmap, 64, 0, ATLAS_GRAPH_X + n,
+		    40 + row->Y - 6 + n, 1, row->Height - n);
+	    }
+	}
+	CpuInfo[c].OldAvgLoadSize = -1;
+    }
+    Atlas.Graphs = rows;
+}
+
+// ------------------------------------------------------------------------- //
+
+/**
+**	Draw CPU graphs.
+**
+**	@param loops		How many loops was collected
+*/
+void DrawCpuGraphs(int loops)
+{
+    const struct atlas_row *row;
+    int n;
+    int c;
+    int rows;
+
+    //
+    //	    copy area to the left
+    //
+    CopyArea(Pixmap, Pixmap, 7, 6, 6, 6, 48, 39);
+
+    rows = Graphs ? Graphs : Cpus;
+    if (rows != Atlas.Graphs) {
+	AtlasBuildGraphs(rows);
+    }
+    for (c = 0; c < rows; ++c) {
+	row = Atlas.Graph + c;
+	n = CpuInfo[c].AvgLoad / loops;
+	n = row->Size[n > 100 ? 100 : n];
+	// draw only if size has changed
+	if (n != CpuInfo[c].OldAvgLoadSize) {
+	    CpuInfo[c].OldAvgLoadSize = n;
+	    CopyArea(AtlasPixmap, Pixmap, ATLAS_GRAPH_X + n, 40 + row->Y - 6,
+		54, row->Y, 1, row->Height);
+	}
+	CpuInfo[c].AvgLoad = 0;
+    }
+    for (; c < MAX_CPUS; ++c) {		// rows removed in this interval
+	CpuInfo[c].AvgLoad = 0;
+    }
+}
+
+/**
+**	Draw CPU bar
+*/
 void DrawCpuBar(void)
 {
-    int n;
-    int c;
-    int y;
-    int o;
-    int r;
+    const struct atlas_row *row;
+    int n;
+    int c;
+
+    CpuSample();
+
+    if (Cpus != Atlas.Bars) {
+	AtlasBuildBars(Cpus);
+    }
+    for (c = 0; c < Cpus; ++c) {
+	row = Atlas.Bar + c;
+	n = CpuInfo[c].Load;
+	n = row->Size[n > 100 ? 100 : n];
+	CpuInfo[c].AvgLoad += CpuInfo[c].History;
+
+	// draw only if size has changed
+	if (n != CpuInfo[c].OldLoadSize) {
+	    CpuInfo[c].OldLoadSize = n;
+	    CopyArea(AtlasPixmap, Pixmap, n * 3, row->Y - 6, 56, row->Y, 3,
+		row->Height);
+	}
+    }
+}
+
+// ------------------------------------------------------------------------- //
+// alert
+
+    ///
+    /// exponentially weighted moving average of a load, with alarm
+    ///
+struct ewma
+{
+    int32_t Value;			///< average in 1/65536 percent
+    uint8_t Alarm;			///< alarm raised
+};
+
+    ///
+    /// kinds of sustained load alerts
+    ///
+enum alert_kind
+{
+    ALERT_CPU,				///< each bar
+    ALERT_MEM,				///< memory usage
+    ALERT_SWAP,				///< swap usage
+    ALERT_KINDS				///< number of alert kinds
+};
+
+    ///
+    /// sustained load alert configuration
+    ///
+static struct alert
+{
+    const char *Name;			///< name in the alert description
+    int Window;				///< averaging window in s, 0 disabled
+    int On;				///< raise alarm at average percent
+    int Off;				///< clear alarm below average percent
+    int Alpha;				///< weight of a sample in 1/65536
+} Alerts[ALERT_KINDS] = {
+    {"cpu", 0, 95, 85, 0},
+    {"mem", 0, 90, 80, 0},
+    {"swap", 0, 50, 40, 0},
+};
+
+static struct ewma CpuEwma[MAX_CPUS];	///< sustained load of the bars
+static struct ewma MemEwma;		///< sustained memory usage
+static struct ewma SwapEwma;		///< sustained swap usage
+static int AlertBlink;			///< blink phase of alarmed bars
+static int AlertMemBlink;		///< blink phase of alarmed widgets
+
+/**
+**	Parse an alert description.
+**
+**	The description is a list of "name=window[:on[:off]]", separated by
+**	comma.  Names are cpu, mem and swap, the window is in seconds, on and
+**	off are the hysteresis thresholds in percent.
+**
+**	@param spec	alert description
+**
+**	@returns -1 if failures.
+*/
+int AlertParse(const char *spec)
+{
+    struct alert *alert;
+    const char *s;
+    char *e;
+    int i;
+    int n;
+
+    for (s = spec; *s;) {
+	if (*s == ',') {
+	    ++s;
+	    continue;
+	}
+	for (i = 0; i < ALERT_KINDS; ++i) {
+	    n = strlen(Alerts[i].Name);
+	    if (!strncmp(s, Alerts[i].Name, n) && s[n] == '=') {
+		break;
+	    }
+	}
+	if (i == ALERT_KINDS) {
+	    fprintf(stderr, "Unknown alert '%s', use cpu=, mem=, swap=\n", s);
+	    return -1;
+	}
+	alert = Alerts + i;
+	alert->Window = strtol(s + n + 1, &e, 10);
+	if (*e == ':') {
+	    alert->On = strtol(e + 1, &e, 10);
+	    alert->Off = alert->On - 10;	// default hysteresis
+	    if (*e == ':') {
+		alert->Off = strtol(e + 1, &e, 10);
+	    }
+	}
+	if ((*e && *e != ',') || alert->Window <= 0 || alert->On > 100
+	    || alert->Off > alert->On || alert->Off < 0) {
+	    fprintf(stderr, "Invalid alert '%s', use window:on:off\n", s);
+	    return -1;
+	}
+	s = e;
+    }
+    return 0;
+}
+
+/**
+**	Setup the alerts, after the refresh rate is known.
+*/
+void AlertSetup(void)
+{
+    int i;
+    int dt;
+
+    for (i = 0; i < ALERT_KINDS; ++i) {
+	if (!Alerts[i].Window) {	// disabled
+	    continue;
+	}
+	// memory is sampled every MemInterval refreshes, -r 0 counts as 1 ms
+	dt = i == ALERT_CPU ? Rate : Rate * MemInterval;
+	if (dt < 1) {
+	    dt = 1;
+	}
+	Alerts[i].Alpha = (65536LL * dt) / (Alerts[i].Window * 1000LL + dt);
+	if (!Alerts[i].Alpha) {		// too long window
+	    Alerts[i].Alpha = 1;
+	}
+    }
+    if (AlertHook) {			// hooks are never waited for
+	signal(SIGCHLD, SIG_IGN);
+    }
+}
+
+/**
+**	Run the alert hook, without waiting for it.
+**
+**	@param name	name of the alarm (cpuN, mem, swap)
+**	@param ewma	moving average with new alarm state
+*/
+static void AlertRun(const char *name, const struct ewma *ewma)
+{
+    char value[12];
+    char *const args[] = {
+	(char *)AlertHook, (char *)name, ewma->Alarm ? "on" : "off", value,
+	NULL
+    };
+    posix_spawnattr_t attr;
+    sigset_t set;
+    pid_t pid;
+    int err;
+
+    if (!AlertHook) {
+	return;
+    }
+    snprintf(value, sizeof(value), "%d", (ewma->Value + 32768) >> 16);
+    // the ignored SIGCHLD is inherited, the hook gets the default
+    posix_spawnattr_init(&attr);
+    sigemptyset(&set);
+    sigaddset(&set, SIGCHLD);
+    posix_spawnattr_setsigdefault(&attr, &set);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+    if ((err = posix_spawnp(&pid, AlertHook, NULL, &attr, args, environ))) {
+	fprintf(stderr, "Can't run alert hook %s: %s\n", AlertHook,
+	    strerror(err));
+    }
+    posix_spawnattr_destroy(&attr);
+}
+
+/**
+**	Add a sample to a moving average and apply the hysteresis.
+**
+**	@param ewma	moving average
+**	@param alert	alert configuration
+**	@param load	new sample in percent
+**
+**	@returns true if the alarm has changed.
+*/
+static int AlertUpdate(struct ewma *ewma, const struct alert *alert,
+    int load)
+{
+    int p;
+
+    ewma->Value +=
+	((int64_t) ((load << 16) - ewma->Value) * alert->Alpha) >> 16;
+    p = (ewma->Value + 32768) >> 16;
+    if (ewma->Alarm ? p < alert->Off : p >= alert->On) {
+	ewma->Alarm ^= 1;
+	return 1;
+    }
+    return 0;
+}
+
+/**
+**	Update the cpu alarms from the loads of the bars, blink alarmed bars.
+**
+**	Called every refresh after the bars are drawn.
+**
+**	@returns 0.
+*/
+int AlertCpus(void)
+{
+    const struct atlas_row *row;
+    char name[16];
+    int c;
+
+    AlertBlink ^= 1;
+    for (c = 0; c < Cpus; ++c) {
+	if (AlertUpdate(CpuEwma + c, Alerts + ALERT_CPU, CpuInfo[c].Load)) {
+	    snprintf(name, sizeof(name), "cpu%d", c);
+	    AlertRun(name, CpuEwma + c);
+	}
+	if (CpuEwma[c].Alarm && AlertBlink) {	// blink: draw empty bar
+	    row = Atlas.Bar + c;
+	    CopyArea(AtlasPixmap, Pixmap, row->Size[0] * 3, row->Y - 6, 56,
+		row->Y, 3, row->Height);
+	    CpuInfo[c].OldLoadSize = -1;
+	}
+    }
+    return 0;
+}
+
+/**
+**	Update the memory and swap alarms.
+**
+**	Called after the memory is sampled.
+**
+**	@returns 0.
+*/
+int AlertMemory(void)
+{
+    int p;
+
+    AlertMemBlink ^= 1;
+    if (Alerts[ALERT_MEM].Window
+	&& AlertUpdate(&MemEwma, Alerts + ALERT_MEM, GetMemory())) {
+	AlertRun("mem", &MemEwma);
+    }
+    if (Alerts[ALERT_SWAP].Window) {
+	if ((p = GetSwap()) < 0) {	// no swap
+	    p = 0;
+	}
+	if (AlertUpdate(&SwapEwma, Alerts + ALERT_SWAP, p)) {
+	    AlertRun("swap", &SwapEwma);
+	}
+    }
+    return 0;
+}
+
+// ------------------------------------------------------------------------- //
+// layout
+
+struct draw_op;
+
+    ///
+    /// widget of the memory area
+    ///
+struct widget
+{
+    const char *Name;			///< name in the layout
+    int (*Percent)(void);		///< value of a bar, -1 not available
+    uint64_t (*Rate)(int *);		///< value and color of a rate graph
+    int Samples;			///< needed samplers (SAMPLE_*)
+    const struct ewma *Ewma;		///< alarm of the widget, NULL none
+};
+
+    ///
+    /// region of the memory area
+    ///
+struct region
+{
+    const char *Name;			///< name in the layout
+    int X;				///< left x coordinate
+    const struct widget *Widget;	///< widget shown in the region
+    int Old;				///< last drawn state of the widget
+};
+
+    ///
+    /// operation of the compiled draw list
+    ///
+struct draw_op
+{
+    void (*Draw)(const struct draw_op *, int);	///< draw with loops
+    int (*Sample)(void);		///< sampler of a sample operation
+    struct region *Region;		///< region of a widget operation
+};
+
+#define SAMPLE_MEM	1		///< needs MemSample
+#define SAMPLE_VMSTAT	2		///< needs GetVmstat
+#define SAMPLE_STAT	4		///< needs ReadStat
+#define SAMPLE_PERF	8		///< needs PerfRead
+#define SAMPLE_PSI	16		///< needs PsiRead
+
+/**
+**	Draw a usage bar widget.
+**
+**	@param op	draw operation
+**	@param loops	unused
+*/
+static void DrawBarWidget(const struct draw_op *op, int loops)
+{
+    struct region *region;
+    const struct ewma *ewma;
+    int p;
+    int n;
+
+    (void)loops;
+    region = op->Region;
+    p = region->Widget->Percent();
+    n = p >= 0 ? (23 * p) / 100 : -1;
+    ewma = region->Widget->Ewma;
+    if (ewma && ewma->Alarm && AlertMemBlink) {	// blink: draw empty bar
+	n = 0;
+    }
+    if (n == region->Old) {		// only draw, if changed
+	return;
+    }
+    region->Old = n;
+    if (n < 0) {			// not available, f.e. no swap
+	CopyArea(Image, Pixmap, 64, 48, region->X, 50, 23, 8);
+	return;
+    }
+    // copy usage bar
+    if (n) {
+	CopyArea(Image, Pixmap, 64, 40, region->X, 50, n, 8);
+    }
+    // clear unused are at the end
+    if (23 - n) {
+	CopyArea(Image, Pixmap, region->X + n, 50, region->X + n, 50, 23 - n,
+	    8);
+    }
+}
+
+/**
+**	Scroll a rate graph of the memory area and draw a new column.
+**
+**	@param x		left x coordinate of the graph
+**	@param rate		events per second, shown logarithmic
+**	@param color		0 (good) - 22 (bad), column of the color sprite
+*/
+static void DrawRateGraph(int x, uint64_t rate, int color)
+{
+    int n;
+
+    // factor 4 per pixel: 8 pixels upto 64k pages/s
+    n = rate ? (64 - __builtin_clzll(rate) + 1) / 2 : 0;
+    if (n > 8) {
+	n = 8;
+    }
+
+    CopyArea(Pixmap, Pixmap, x + 1, 50, x, 50, 22, 8);
+    if (n != 8) {
+	CopyArea(Image, Pixmap, x + 22, 50, x + 22, 50, 1, 8 - n);
+    }
+    if (n) {
+	CopyArea(Image, Pixmap, 64 + color, 40 + 8 - n, x + 22,
+	    50 + 8 - n, 1, n);
+    }
+}
+
+/**
+**	Draw a rate graph widget.
+**
+**	A graph, which is flat at zero, isn't scrolled.
+**
+**	@param op	draw operation
+**	@param loops	unused
+*/
+static void DrawRateWidget(const struct draw_op *op, int loops)
+{
+    struct region *region;
+    uint64_t rate;
+    int color;
+
+    (void)loops;
+    region = op->Region;
+    color = 0;
+    rate = region->Widget->Rate(&color);
+    if (!rate) {
+	if (region->Old >= 23) {	// all columns are zero
+	    return;
+	}
+	++region->Old;
+    } else {
+	region->Old = 0;
+    }
+    DrawRateGraph(region->X, rate, color > 22 ? 22 : color);
+}
+
+/**
+**	Color of a rate, red at 64k/s.
+**
+**	@param rate	events per second
+**
+**	@returns column of the color sprite.
+*/
+static int RateColor(uint64_t rate)
+{
+    int bits;
+
+    bits = rate ? 64 - __builtin_clzll(rate) : 0;	// 16 bits are max
+    return bits >= 16 ? 22 : (22 * bits) / 16;
+}
+
+/**
+**	Reclaim scan rate, the color shows the reclaim efficiency
+**	(stolen/scanned).
+**
+**	@param[out] color	color of the rate
+**
+**	@returns pages scanned per second.
+*/
+static uint64_t RateReclaim(int *color)
+{
+    if (Vmstat.Scan) {
+	*color = Vmstat.Steal < Vmstat.Scan ?
+	    22 - (22 * Vmstat.Steal) / Vmstat.Scan : 0;
+    }
+    return Vmstat.Scan;
+}
+
+/**
+**	Swap in/out and major fault rate.
+**
+**	@param[out] color	color of the rate
+**
+**	@returns pages swapped and major faults per second.
+*/
+static uint64_t RatePaging(int *color)
+{
+    *color = RateColor(Vmstat.Swap + Vmstat.Faults);
+    return Vmstat.Swap + Vmstat.Faults;
+}
+
+/**
+**	Runnable tasks, the color shows the runnable tasks per cpu (red 2 or
+**	more).
+**
+**	@param[out] color	color of the rate
+**
+**	@returns runnable tasks.
+*/
+static uint64_t RateTasks(int *color)
+{
+    long cpus;
 
-    GetStat();
+    if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1) {
+	cpus = 1;
+    }
+    *color = (11 * ProcsRunning) / cpus;
+    return ProcsRunning;
+}
 
-    y = 6;
-    o = 40 / Cpus;
-    r = 40 % Cpus;
-    for (c = 0; c < Cpus; ++c) {
-	if (!r--) {			// no remainder reduce
-	    --o;
+/**
+**	Context switch rate, the color shows the tasks blocked on I/O per cpu
+**	(red 1 or more).
+**
+**	@param[out] color	color of the rate
+**
+**	@returns context switches per second.
+*/
+static uint64_t RateCtxt(int *color)
+{
+    static uint64_t old_ctxt;
+    static uint64_t old_time;
+    uint64_t now;
+    uint64_t rate;
+    long cpus;
+
+    if ((cpus = sysconf(_SC_NPROCESSORS_ONLN)) < 1) {
+	cpus = 1;
+    }
+    now = GetUsTime();
+    rate = 0;
+    if (old_time && now > old_time) {
+	rate = ((Ctxt - old_ctxt) * 1000000) / (now - old_time);
+    }
+    old_ctxt = Ctxt;
+    old_time = now;
+    *color = (22 * ProcsBlocked) / cpus;
+    return rate;
+}
+
+/**
+**	Cpu migration rate, the color shows the migrations per context switch
+**	(red 1 of 4 or more).
+**
+**	@param[out] color	color of the rate
+**
+**	@returns migrations per second.
+*/
+static uint64_t RateMigrations(int *color)
+{
+    if (Perf.Rate[PERF_SWITCHES]) {
+	*color = (88 * Perf.Rate[PERF_MIGRATIONS]) / Perf.Rate[PERF_SWITCHES];
+    }
+    return Perf.Rate[PERF_MIGRATIONS];
+}
+
+/**
+**	Page fault rate.
+**
+**	@param[out] color	color of the rate
+**
+**	@returns page faults per second.
+*/
+static uint64_t RateFaults(int *color)
+{
+    *color = RateColor(Perf.Rate[PERF_FAULTS]);
+    return Perf.Rate[PERF_FAULTS];
+}
+
+    ///
+    /// widgets of the memory area
+    ///
+static const struct widget Widgets[] = {
+    {"mem", GetMemory, NULL, SAMPLE_MEM, &MemEwma},
+    {"swap", GetSwap, NULL, SAMPLE_MEM, &SwapEwma},
+    {"reclaim", NULL, RateReclaim, SAMPLE_VMSTAT, NULL},
+    {"paging", NULL, RatePaging, SAMPLE_VMSTAT, NULL},
+    {"tasks", NULL, RateTasks, SAMPLE_STAT, NULL},
+    {"ctxt", NULL, RateCtxt, SAMPLE_STAT, NULL},
+    {"migrations", NULL, RateMigrations, SAMPLE_PERF, NULL},
+    {"faults", NULL, RateFaults, SAMPLE_PERF, NULL},
+    {"mempsi", GetMemoryPressure, NULL, SAMPLE_PSI, NULL},
+    {"cpupsi", GetCpuPressure, NULL, SAMPLE_PSI, NULL},
+};
+
+#define WIDGETS (int)(sizeof(Widgets) / sizeof(*Widgets))
+
+    ///
+    /// regions of the memory area
+    ///
+static struct region Regions[] = {
+    {"left", 6, Widgets + 0, 0},
+    {"right", 35, Widgets + 1, 0},
+};
+
+#define REGIONS (int)(sizeof(Regions) / sizeof(*Regions))
+
+    ///
+    /// regions of the cpu area
+    ///
+static const char *const CpuRegions[] = {
+    "bars", "history",
+};
+
+#define CPU_REGIONS (int)(sizeof(CpuRegions) / sizeof(*CpuRegions))
+
+    ///
+    /// views of the cpu area: source of the bars and their history graph,
+    /// content of the history area
+    ///
+static const struct view
+{
+    const char *Name;			///< name of the view
+    int Region;				///< index into CpuRegions
+    char *Flag;				///< mode flag set by the view
+} Views[] = {
+    {"cpu", 0, NULL},
+    {"summary", 0, &Summarize},
+    {"irq", 0, &IrqMode},
+    {"runqueue", 0, &RunQueue},
+    {"perf", 0, &PerfMode},
+    {"graph", 1, NULL},
+    {"top", 1, &TopMode},
+};
+
+#define VIEWS (int)(sizeof(Views) / sizeof(*Views))
+
+static struct draw_op SlowOps[8];	///< compiled draw list, every 10th
+static struct draw_op MemOps[8];	///< compiled draw list, memory area
+static struct draw_op StallOps[8];	///< memory area without alarms
+static struct draw_op TickOps[5];	///< compiled draw list, every tick
+
+/**
+**	Draw operation: call a sampler.
+**
+**	@param op	draw operation
+**	@param loops	unused
+*/
+static void DrawSample(const struct draw_op *op, int loops)
+{
+    (void)loops;
+    op->Sample();
+}
+
+/**
+**	Draw operation: cpu history graphs.
+**
+**	@param op	unused
+**	@param loops	how many loops was collected
+*/
+static void DrawCpuGraphsOp(const struct draw_op *op, int loops)
+{
+    (void)op;
+    DrawCpuGraphs(loops);
+}
+
+/**
+**	Draw operation: cpu bars.
+**
+**	@param op	unused
+**	@param loops	unused
+*/
+static void DrawCpuBarOp(const struct draw_op *op, int loops)
+{
+    (void)op;
+    (void)loops;
+    DrawCpuBar();
+}
+
+/**
+**	Draw operation: top cpu users.
+**
+**	@param op	unused
+**	@param loops	unused
+*/
+static void DrawTopOp(const struct draw_op *op, int loops)
+{
+    (void)op;
+    (void)loops;
+    DrawTop();
+}
+
+/**
+**	Draw operation: interrupt labels.
+**
+**	@param op	unused
+**	@param loops	0 if the graph has scrolled
+*/
+static void DrawIrqLabelsOp(const struct draw_op *op, int loops)
+{
+    (void)op;
+    DrawIrqLabels(!loops);		// graph scrolled, redraw labels
+}
+
+/**
+**	Find a name in a table.
+**
+**	@param s	name, not terminated
+**	@param n	length of name
+**	@param table	table of structures starting with a name
+**	@param size	size of a table entry
+**	@param count	entries in the table
+**
+**	@returns index of the name, -1 if not found.
+*/
+static int LayoutFind(const char *s, int n, const void *table, size_t size,
+    int count)
+{
+    const char *name;
+    int i;
+
+    for (i = 0; i < count; ++i) {
+	name = *(const char *const *)((const char *)table + i * size);
+	if ((int)strlen(name) == n && !strncmp(name, s, n)) {
+	    return i;
 	}
+    }
+    return -1;
+}
 
-	n = CpuInfo[c].Load;
-	CpuInfo[c].AvgLoad += n;
-	if (Logscale) {
-	    n = Log10[n];
+/**
+**	Parse a layout description.
+**
+**	The description is a list of "region=widget", separated by comma,
+**	space or newline, "#" starts a comment.  Without "=" the description
+**	is the name of a file containing it.  The views of the cpu area set
+**	the mode flags, must be parsed before the samplers are opened.
+**
+**	@param spec	layout description or file name
+**
+**	@returns -1 if failures.
+*/
+int LayoutParse(const char *spec)
+{
+    char buf[1024];
+    const char *s;
+    const char *e;
+    int fd;
+    int i;
+    int j;
+    int k;
+
+    if (!strchr(spec, '=')) {		// config file
+	if ((fd = open(spec, O_RDONLY | O_CLOEXEC)) < 0) {
+	    fprintf(stderr, "Can't open layout %s: %s\n", spec,
+		strerror(errno));
+	    return -1;
+	}
+	i = ReadFd(fd, buf, sizeof(buf));
+	close(fd);
+	if (i < 0) {
+	    fprintf(stderr, "Can't read layout %s\n", spec);
+	    return -1;
 	}
-	// draw graph
-	n = o - ((o * n) / 100);
+	spec = buf;
+    }
 
-	// draw only if size has changed
-	if (n != CpuInfo[c].OldLoadSize) {
-	    CpuInfo[c].OldLoadSize = n;
-	    if (n) {
-		xcb_copy_area(Connection, Image, Pixmap, NormalGC, 56, y, 56,
-		    y, 3, n);
+    for (s = spec; *s;) {
+	if (*s == '#') {		// comment upto end of line
+	    s = strchrnul(s, '\n');
+	    continue;
+	}
+	if (strchr(", \t\n", *s)) {
+	    ++s;
+	    continue;
+	}
+	e = s + strcspn(s, "=, \t\n#");
+	i = LayoutFind(s, e - s, Regions, sizeof(*Regions), REGIONS);
+	k = LayoutFind(s, e - s, CpuRegions, sizeof(*CpuRegions),
+	    CPU_REGIONS);
+	if ((i < 0 && k < 0) || *e != '=') {
+	    fprintf(stderr, "Unknown layout region '%.*s', use left, right, "
+		"bars, history\n", (int)(e - s), s);
+	    return -1;
+	}
+	s = e + 1;
+	e = s + strcspn(s, ", \t\n#");
+	if (k >= 0) {			// cpu area
+	    j = LayoutFind(s, e - s, Views, sizeof(*Views), VIEWS);
+	    if (j < 0 || Views[j].Region != k) {
+		fprintf(stderr, "Unknown %s view '%.*s', use %s\n",
+		    CpuRegions[k], (int)(e - s), s,
+		    k ? "graph, top" : "cpu, summary, irq, runqueue, perf");
+		return -1;
+	    }
+	    // views of a region exclude each other
+	    for (i = 0; i < VIEWS; ++i) {
+		if (Views[i].Region == k && Views[i].Flag) {
+		    *Views[i].Flag = 0;
+		}
 	    }
-	    if (n != o) {
-		xcb_copy_area(Connection, Image, Pixmap, NormalGC,
-		    65 - 3 + Cpus * 3, n, 56, y + n, 3, o - n);
+	    if (Views[j].Flag) {
+		*Views[j].Flag = 1;
 	    }
+	    s = e;
+	    continue;
 	}
-	y += o + 1;
+	j = LayoutFind(s, e - s, Widgets, sizeof(*Widgets), WIDGETS);
+	if (j < 0) {
+	    fprintf(stderr, "Unknown layout widget '%.*s', use mem, swap, "
+		"reclaim, paging, tasks, ctxt, migrations, faults, mempsi, "
+		"cpupsi\n",
+		(int)(e - s), s);
+	    return -1;
+	}
+	Regions[i].Widget = Widgets + j;
+	s = e;
     }
+    return 0;
 }
 
 /**
-**	Draw memory information.
+**	Compile the layout and modes into the draw lists.
+**
+**	Called at startup and when the top cpu users are toggled.  The draw
+**	lists contain only the needed operations, the refresh has no branches
+**	on modes.  The memory bars have their own list, a copy without the
+**	alarms is run for pressure stall events.
+**
+**	@returns samplers needed by the widgets (SAMPLE_*).
 */
-void DrawMemGraphs(void)
+int LayoutCompile(void)
 {
-    int p;
-    int n;
-    static int old_m;
-    static int old_s;
+    struct draw_op *op;
+    int samples;
+    int i;
 
-    GetMeminfo();			// cache /proc/meminfo
+    samples = 0;
+    for (i = 0; i < REGIONS; ++i) {
+	samples |= Regions[i].Widget->Samples;
+    }
+    if (Alerts[ALERT_MEM].Window || Alerts[ALERT_SWAP].Window) {
+	samples |= SAMPLE_MEM;
+    }
 
-    p = GetMemory();
-    // copy memory usage bar
-    n = (23 * p) / 100;
-    if (n != old_m) {			// only draw, if changed
-	old_m = n;
-	if (n) {
-	    xcb_copy_area(Connection, Image, Pixmap, NormalGC, 64, 40, 6, 50,
-		n, 8);
+    //
+    //	every MemInterval tick: memory samplers, alarms, bar widgets
+    //
+    memset(MemOps, 0, sizeof(MemOps));
+    op = MemOps;
+    if (samples & SAMPLE_MEM) {
+	op->Draw = DrawSample;
+	op++->Sample = MemSample;
+    }
+    if (samples & SAMPLE_PSI) {
+	op->Draw = DrawSample;
+	op++->Sample = PsiRead;
+    }
+    if (Alerts[ALERT_MEM].Window || Alerts[ALERT_SWAP].Window) {
+	op->Draw = DrawSample;
+	op++->Sample = AlertMemory;
+    }
+    for (i = 0; i < REGIONS; ++i) {
+	if (Regions[i].Widget->Percent) {
+	    op->Draw = DrawBarWidget;
+	    op++->Region = Regions + i;
 	}
-	// clear unused are at the end
-	if (23 - n) {
-	    xcb_copy_area(Connection, Image, Pixmap, NormalGC, 6 + n, 50,
-		6 + n, 50, 23 - n, 8);
+    }
+
+    //
+    //	stall events: the same without alarms, their averages need evenly
+    //	spaced samples
+    //
+    memset(StallOps, 0, sizeof(StallOps));
+    op = StallOps;
+    for (i = 0; MemOps[i].Draw; ++i) {
+	if (MemOps[i].Sample != AlertMemory) {
+	    *op++ = MemOps[i];
 	}
     }
 
-    p = GetSwap();
-    if (p != old_s) {			// only draw, if changed
-	old_s = p;
-	if (p >= 0) {
-	    // copy memory usage bar
-	    n = (23 * p) / 100;
-	    if (n >= 0) {
-		xcb_copy_area(Connection, Image, Pixmap, NormalGC, 64, 40, 35,
-		    50, n, 8);
-	    }
-	    // clear unused are at the end
-	    if (23 - n) {
-		xcb_copy_area(Connection, Image, Pixmap, NormalGC, 35 + n, 50,
-		    35 + n, 50, 23 - n, 8);
-	    }
-	} else {
-	    xcb_copy_area(Connection, Image, Pixmap, NormalGC, 64, 48, 35, 50,
-		23, 8);
+    //
+    //	every 10th tick: history, samplers, rate widgets
+    //
+    memset(SlowOps, 0, sizeof(SlowOps));
+    op = SlowOps;
+    if (!TopMode) {
+	op++->Draw = DrawCpuGraphsOp;
+    }
+    if (samples & SAMPLE_VMSTAT) {
+	op->Draw = DrawSample;
+	op++->Sample = GetVmstat;
+    }
+    // /proc/stat is already read every tick
+    if (samples & SAMPLE_STAT && CpuSample != GetStat) {
+	op->Draw = DrawSample;
+	op++->Sample = ReadStat;
+    }
+    // -e reads the counters every tick
+    if (samples & SAMPLE_PERF && CpuSample != GetPerfStat) {
+	op->Draw = DrawSample;
+	op++->Sample = PerfRead;
+    }
+    for (i = 0; i < REGIONS; ++i) {
+	if (!Regions[i].Widget->Percent) {
+	    op->Draw = DrawRateWidget;
+	    op++->Region = Regions + i;
 	}
     }
+
+    //
+    //	every tick: bars and overlays of the history
+    //
+    memset(TickOps, 0, sizeof(TickOps));
+    op = TickOps;
+    op++->Draw = DrawCpuBarOp;
+    if (Alerts[ALERT_CPU].Window) {
+	op->Draw = DrawSample;
+	op++->Sample = AlertCpus;
+    }
+    if (TopMode) {
+	op++->Draw = DrawTopOp;
+    } else if (IrqMode) {
+	op++->Draw = DrawIrqLabelsOp;
+    }
+
+    return samples;
 }
 
 // ------------------------------------------------------------------------- //
@@ -968,23 +4838,48 @@ void DrawMemGraphs(void)
 void Timeout(void)
 {
     static int loops;
+    static int mem_loops;
+    const struct draw_op *op;
 
     //
     // Update everything
     //
     if (++loops == 10) {		// graph is slower redrawn
-	DrawCpuGraphs(loops);
-	DrawMemGraphs();
+	for (op = SlowOps; op->Draw; ++op) {
+	    op->Draw(op, loops);
+	}
 	loops = 0;
     }
-    DrawCpuBar();
+    if (!mem_loops--) {			// memory on stall events earlier
+	for (op = MemOps; op->Draw; ++op) {
+	    op->Draw(op, 0);
+	}
+	mem_loops = MemInterval - 1;
+    }
+    for (op = TickOps; op->Draw; ++op) {
+	op->Draw(op, loops);
+    }
 
     // FIXME: not the complete area need to be redraw!!!
-    xcb_clear_area(Connection, 0, Window, 0, 0, 64, 64);
+    ClearArea(0, 0, 64, 64);
     // flush the request
     xcb_flush(Connection);
 }
 
+/**
+**	Refresh the memory area now, called for pressure stall events.
+*/
+void MemRefresh(void)
+{
+    const struct draw_op *op;
+
+    for (op = StallOps; op->Draw; ++op) {
+	op->Draw(op, 0);
+    }
+    ClearArea(6, 50, 52, 8);
+    xcb_flush(Connection);
+}
+
 /**
 **	Prepare our graphic data.
 */
@@ -993,8 +4888,11 @@ void PrepareData(void)
     xcb_pixmap_t shape;
 
     Image = CreatePixmap((void *)wmcpumon_xpm, &shape);
+    AtlasPixmap = xcb_generate_id(Connection);
+    xcb_create_pixmap(Connection, Screen->root_depth, AtlasPixmap, Window,
+	(ATLAS_GRAPH_X + 41) * Scale, 80 * Scale);
     // Copy background part
-    xcb_copy_area(Connection, Image, Pixmap, NormalGC, 0, 0, 0, 0, 64, 64);
+    CopyArea(Image, Pixmap, 0, 0, 0, 0, 64, 64);
     if (shape) {
 	xcb_shape_mask(Connection, XCB_SHAPE_SO_SET, XCB_SHAPE_SK_BOUNDING,
 	    Window, 0, 0, shape);
@@ -1004,6 +4902,55 @@ void PrepareData(void)
     Timeout();
 }
 
+/**
+**	Measure the refresh without X server.
+**
+**	The X requests go to a failed connection, which discards them.  The
+**	graphics are prepared like with a server, for a TrueColor screen,
+**	that pgo also trains the XPM, scale and atlas code.  With -R the
+**	next recorded sample is switched in outside of the measured time.
+**
+**	@param ticks	number of refreshes
+*/
+void Benchmark(int ticks)
+{
+    // screen with its depth and visual, as returned by the server
+    static struct
+    {
+	xcb_screen_t Screen;
+	xcb_depth_t Depth;
+	xcb_visualtype_t Visual;
+    } server = {
+	.Screen = {.root_visual = 1, .root_depth = 24,
+	    .allowed_depths_len = 1},
+	.Depth = {.depth = 24, .visuals_len = 1},
+	.Visual = {.visual_id = 1, ._class = XCB_VISUAL_CLASS_TRUE_COLOR,
+	    .bits_per_rgb_value = 8, .red_mask = 0xFF0000,
+	    .green_mask = 0x00FF00, .blue_mask = 0x0000FF},
+    };
+    uint64_t start;
+    uint64_t time;
+    int i;
+
+    Connection = xcb_connect_to_fd(-1, NULL);
+    Screen = &server.Screen;
+    PrepareData();
+
+    time = 0;
+    for (i = 0; i < ticks; ++i) {
+	if (ReplayDir) {
+	    ReplayNext();
+	}
+	start = GetUsTime();
+	Timeout();
+	time += GetUsTime() - start;
+    }
+    printf("%d refreshes in %" PRIu64 " us, %" PRIu64 " ns/refresh\n", ticks,
+	time, (time * 1000) / ticks);
+
+    xcb_disconnect(Connection);
+}
+
 // ------------------------------------------------------------------------- //
 
 /**
@@ -1024,14 +4971,44 @@ static void PrintVersion(void)
 */
 static void PrintUsage(void)
 {
-    printf("Usage: wmcpumon [-a] [-c n] [-j] [-l] [-r rate] [-s] [-w]\n"
+    printf("Usage: wmcpumon [-a] [-c n] [-d disks] [-e] [-g cgroup] [-i] [-j]"
+	" [-l] [-m mode]\n\t[-n interfaces] [-p pid] [-q] [-r rate] [-s] [-u]"
+	" [-v] [-w]\n\t[-x hook] [-z size] [-A alerts] [-L layout] [-C cpus]"
+	" [-E event] [-I] [-M]\n\t[-N nice] [-T slack] [-b ticks] [-R replay]\n"
 	"\t-a\tdisplay the aggregate numbers of all cores\n"
+	"\t-b n\tmeasure n refreshes without X server and exit\n"
 	"\t-c n\tfirst CPU to use (to monitor more than 4 cores)\n"
+	"\t-d list\tshow utilization and throughput of disks (sda,sdb or all)\n"
+	"\t-e\tshow context switches, migrations, page faults (perf events)\n"
+	"\t-g dir\tmonitor the cgroup v2 directory against its limits\n"
+	"\t-i\tshow the CPUs with the highest interrupt + softirq rates\n"
 	"\t-j\tjoin two CPUs (for hyper-threading CPUs)\n"
 	"\t-l\tuse a logarithmic scale\n"
+	"\t-m mode\tmemory accounting: a=MemAvailable (default), c=classic\n"
+	"\t\tf=like htop, h=huge pages and dirty/writeback\n"
+	"\t-n list\tshow receive/transmit rate of interfaces (eth0,eth1 or all)\n"
+	"\t-p pid\tshow the CPU usage of the threads of a process per CPU\n"
+	"\t-q\tshow run queue wait per timeslice, runnable tasks, context"
+	" switches\n"
 	"\t-r rate\trefresh rate (in milliseconds, default 250 ms)\n"
 	"\t-s\tsleep while screen-saver is running or video blanked\n"
-	"\t-w\tStart in window mode\n" "Only idiots print usage on stderr!\n");
+	"\t-u\tshow p50, p90, p99, max load of all CPUs, imbalance history\n"
+	"\t-v\tshow reclaim and swap/major fault rates instead of usage\n"
+	"\t-w\tStart in window mode\n"
+	"\t-x prog\trun prog name on|off percent, when an alarm changes\n"
+	"\t-z size\twindow size, multiple of 64 (f.e. 128 for HiDPI)\n"
+	"\t-A spec\talarm on sustained load (cpu=300:95:85,mem=600:90:80,"
+	"swap=...)\n"
+	"\t-L spec\tlayout (left=reclaim,right=ctxt,bars=irq,history=top) or"
+	" file\n"
+	"\t-C list\trun only on these housekeeping CPUs (0-1,8)\n"
+	"\t-E ev\t-e with bars of switches (default), migrations or faults\n"
+	"\t-I\trun with SCHED_IDLE scheduling policy\n"
+	"\t-M\tlock memory to avoid page faults\n"
+	"\t-N nice\trun with this nice value\n"
+	"\t-R dir\treplay the /proc samples recorded in dir (make record)\n"
+	"\t-T us\ttimer slack (in microseconds)\n"
+	"Only idiots print usage on stderr!\n");
 }
 
 /**
@@ -1042,34 +5019,140 @@ static void PrintUsage(void)
 */
 int main(int argc, char *const argv[])
 {
+    int samples;
+
     Rate = 250;				// 250 ms default update rate
 
     //
     //	Parse arguments.
     //
     for (;;) {
-	switch (getopt(argc, argv, "h?-ac:jlr:sw")) {
+	switch (getopt(argc, argv,
+		"h?-ab:c:d:eg:ijlm:n:p:qr:suvwx:z:A:C:E:IL:MN:R:T:")) {
 	    case 'a':			// all cpus
 		AllCpus = 1;
 		continue;
+	    case 'b':			// benchmark
+		BenchmarkTicks = atoi(optarg);
+		continue;
 	    case 'c':			// cpu start
 		StartCpu = atoi(optarg);
 		continue;
+	    case 'd':			// disks
+		DiskList = optarg;
+		continue;
+	    case 'e':			// perf events
+		PerfMode = 1;
+		continue;
+	    case 'E':			// perf event of the bars
+		if (!strcmp(optarg, "switches")) {
+		    PerfBar = PERF_SWITCHES;
+		} else if (!strcmp(optarg, "migrations")) {
+		    PerfBar = PERF_MIGRATIONS;
+		} else if (!strcmp(optarg, "faults")) {
+		    PerfBar = PERF_FAULTS;
+		} else {
+		    PrintVersion();
+		    fprintf(stderr, "Unknown perf event '%s', use switches, "
+			"migrations, faults\n", optarg);
+		    return -1;
+		}
+		PerfMode = 1;
+		continue;
+	    case 'g':			// cgroup v2 directory
+		CgroupDir = optarg;
+		continue;
+	    case 'i':			// interrupts
+		IrqMode = 1;
+		continue;
 	    case 'j':			// join cpu's
 		JoinCpus = 1;
 		continue;
 	    case 'l':			// logarithmic scale
 		Logscale = 1;
 		continue;
+	    case 'm':			// memory accounting mode
+		switch (*optarg) {
+		    case 'a':
+			MemMode = MEM_AVAILABLE;
+			break;
+		    case 'c':
+			MemMode = MEM_CLASSIC;
+			break;
+		    case 'f':
+			MemMode = MEM_FREE;
+			break;
+		    case 'h':
+			MemMode = MEM_HUGE_DIRTY;
+			break;
+		    default:
+			PrintVersion();
+			fprintf(stderr, "Unknown memory mode '%s'\n", optarg);
+			return -1;
+		}
+		continue;
+	    case 'n':			// network interfaces
+		NetList = optarg;
+		continue;
+	    case 'p':			// process
+		ProcessPid = atoi(optarg);
+		continue;
+	    case 'q':			// run queue
+		RunQueue = 1;
+		continue;
 	    case 'r':			// update rate
 		Rate = atoi(optarg);
 		continue;
 	    case 's':			// sleep while screensaver running
 		UseSleep = 1;
 		continue;
+	    case 'u':			// summary of all cpus
+		Summarize = 1;
+		continue;
+	    case 'v':			// vmstat paging rates
+		PagingRates = 1;
+		continue;
 	    case 'w':			// window mode
 		WindowMode = 1;
 		continue;
+	    case 'x':			// alert hook
+		AlertHook = optarg;
+		continue;
+	    case 'z':			// window size
+		Scale = atoi(optarg) / 64;
+		if (Scale < 1 || Scale * 64 != atoi(optarg)) {
+		    PrintVersion();
+		    fprintf(stderr, "Window size '%s' isn't a multiple of 64\n",
+			optarg);
+		    return -1;
+		}
+		continue;
+	    case 'A':			// alerts
+		if (AlertParse(optarg) < 0) {
+		    return -1;
+		}
+		continue;
+	    case 'C':			// housekeeping cpus
+		Housekeeping = optarg;
+		continue;
+	    case 'I':			// idle scheduling policy
+		IdlePolicy = 1;
+		continue;
+	    case 'L':			// layout
+		LayoutSpec = optarg;
+		continue;
+	    case 'M':			// lock memory
+		LockMemory = 1;
+		continue;
+	    case 'N':			// nice value
+		Niceness = atoi(optarg);
+		continue;
+	    case 'R':			// replay
+		ReplayDir = optarg;
+		continue;
+	    case 'T':			// timer slack
+		TimerSlack = atoi(optarg);
+		continue;
 
 	    case EOF:
 		break;
@@ -1101,9 +5184,96 @@ int main(int argc, char *const argv[])
 	return -1;
     }
 
+    // modes select the default layout
+    if (PagingRates) {
+	LayoutParse("left=reclaim,right=paging");
+    } else if (RunQueue) {
+	LayoutParse("left=tasks,right=ctxt");
+    } else if (PerfMode) {
+	LayoutParse("left=migrations,right=faults");
+    }
+    if (LayoutSpec && LayoutParse(LayoutSpec) < 0) {
+	return -1;
+    }
+
+    if (ReplayDir && ReplayOpen() < 0) {
+	return -1;
+    }
+    CpuRowInit();
+    if (SchedulingSetup() < 0) {
+	return -1;
+    }
+
+    if (CgroupDir) {
+	if (CgroupOpen(CgroupDir) < 0) {
+	    return -1;
+	}
+	CpuSample = GetCgroupStat;
+	MemSample = GetCgroupMeminfo;
+    }
+    if (DiskList) {
+	if (DiskOpen(DiskList) < 0) {
+	    return -1;
+	}
+	CpuSample = GetDiskstats;
+    }
+    if (NetList) {
+	if (NetOpen(NetList) < 0) {
+	    return -1;
+	}
+	CpuSample = GetNetDev;
+    }
+    if (IrqMode) {
+	if (IrqOpen() < 0) {
+	    return -1;
+	}
+	CpuSample = GetIrqStat;
+    }
+    if (RunQueue) {
+	if (SchedstatOpen() < 0) {
+	    return -1;
+	}
+	CpuSample = GetSchedstat;
+    }
+    if (PerfMode) {
+	if (PerfOpen() < 0) {
+	    return -1;
+	}
+	CpuSample = GetPerfStat;
+    }
+    if (ProcessPid) {
+	if (ProcessOpen(ProcessPid) < 0) {
+	    return -1;
+	}
+	CpuSample = GetProcessStat;
+    }
+    if (Summarize) {
+	CpuSample = GetSummaryStat;
+    }
+
+    samples = LayoutCompile();
+    if (samples & SAMPLE_PERF && !PerfMode && PerfOpen() < 0) {
+	return -1;
+    }
+    // memory alarms need the regular samples
+    if (samples & (SAMPLE_MEM | SAMPLE_PSI) && PsiOpen()
+	&& !Alerts[ALERT_MEM].Window && !Alerts[ALERT_SWAP].Window) {
+	MemInterval *= PSI_BACKGROUND;	// refreshed by stall events
+    }
+    AlertSetup();
+
+    if (BenchmarkTicks > 0) {
+	Benchmark(BenchmarkTicks);
+	return 0;
+    }
+
     Init(argc, argv);
 
     PrepareData();
+    // working set is allocated, later growth may fault
+    if (LockMemory && mlockall(MCL_CURRENT)) {
+	fprintf(stderr, "Can't lock memory: %s\n", strerror(errno));
+    }
     Loop();
     Exit();
 